@@ -0,0 +1,141 @@
+/* -*- c++ -*-
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Raw memory for objects of one size, carved out of large slabs. Freed slots are kept in an
+// intrusive free list and handed out again before a new slab is allocated. The arena does
+// not construct or destroy objects, the owner does that with placement new and explicit
+// destructor calls. Destroying the arena releases all slabs at once.
+struct SlabArena
+{
+private:
+	size_t object_size_;
+	int slab_objects_;
+	std::vector<char*> slabs_;
+	void *free_list_ = nullptr;
+	int num_live_ = 0;
+
+	size_t slab_size() const {
+		return object_size_ * slab_objects_;
+	}
+
+	// Pushes the unused slots of a slab such that they are handed out in address order
+	void push_slab(char *slab, const std::vector<bool> *live = nullptr, int first_slot = 0)
+	{
+		for (int i = slab_objects_ - 1; i >= 0; i--) {
+			if (live && (*live)[first_slot + i])
+				continue;
+			void *slot = slab + i * object_size_;
+			*static_cast<void**>(slot) = free_list_;
+			free_list_ = slot;
+		}
+	}
+
+public:
+	SlabArena(size_t object_size, int slab_objects = 1024) : slab_objects_(slab_objects)
+	{
+		const size_t align = alignof(std::max_align_t);
+		object_size_ = (max(object_size, sizeof(void*)) + align - 1) / align * align;
+	}
+
+	~SlabArena()
+	{
+		for (auto slab : slabs_)
+			::operator delete(slab);
+	}
+
+	SlabArena(const SlabArena &) = delete;
+	SlabArena &operator=(const SlabArena &) = delete;
+
+	void *allocate()
+	{
+		if (free_list_ == nullptr) {
+			char *slab = static_cast<char*>(::operator new(slab_size()));
+			slabs_.push_back(slab);
+			push_slab(slab);
+		}
+		void *slot = free_list_;
+		free_list_ = *static_cast<void**>(slot);
+		num_live_++;
+		return slot;
+	}
+
+	void deallocate(void *slot)
+	{
+		*static_cast<void**>(slot) = free_list_;
+		free_list_ = slot;
+		num_live_--;
+	}
+
+	// Releases every slab that holds none of the given objects, which must be all objects
+	// that are currently allocated from this arena. The free list is rebuilt in address
+	// order, so new objects fill the remaining slabs from the front. Returns the number of
+	// released slabs.
+	template<typename It>
+	int compact(It first, It last)
+	{
+		std::vector<char*> slabs = slabs_;
+		std::sort(slabs.begin(), slabs.end());
+
+		std::vector<bool> live(slabs.size() * slab_objects_);
+		std::vector<int> slab_live(slabs.size());
+		int num_live = 0;
+		for (It it = first; it != last; ++it) {
+			char *ptr = reinterpret_cast<char*>(*it);
+			auto slab_it = std::upper_bound(slabs.begin(), slabs.end(), ptr);
+			log_assert(slab_it != slabs.begin());
+			int slab_idx = slab_it - slabs.begin() - 1;
+			size_t offset = ptr - slabs[slab_idx];
+			log_assert(offset < slab_size() && offset % object_size_ == 0);
+			live[slab_idx * slab_objects_ + offset / object_size_] = true;
+			slab_live[slab_idx]++;
+			num_live++;
+		}
+		log_assert(num_live == num_live_);
+
+		slabs_.clear();
+		free_list_ = nullptr;
+		int released = 0;
+		for (int i = GetSize(slabs) - 1; i >= 0; i--) {
+			if (slab_live[i] == 0) {
+				::operator delete(slabs[i]);
+				released++;
+				continue;
+			}
+			push_slab(slabs[i], &live, i * slab_objects_);
+			slabs_.push_back(slabs[i]);
+		}
+		std::reverse(slabs_.begin(), slabs_.end());
+		return released;
+	}
+
+	int num_live() const { return num_live_; }
+	int num_slabs() const { return GetSize(slabs_); }
+	size_t capacity_bytes() const { return slabs_.size() * slab_size(); }
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
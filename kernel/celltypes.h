@@ -182,6 +182,7 @@ struct CellTypes
 		setup_type(ID($mem_v2), {ID::RD_CLK, ID::RD_EN, ID::RD_ARST, ID::RD_SRST, ID::RD_ADDR, ID::WR_CLK, ID::WR_EN, ID::WR_ADDR, ID::WR_DATA}, {ID::RD_DATA});
 
 		setup_type(ID($fsm), {ID::CLK, ID::ARST, ID::CTRL_IN}, {ID::CTRL_OUT});
+		setup_type(ID($coverage_map), {ID::CLK, ID::ADDR}, {ID(COUNT)});
 	}
 
 	void setup_stdcells()
@@ -298,6 +299,15 @@ struct CellTypes
 		cell_types.clear();
 	}
 
+	void settle() const
+	{
+		cell_types.settle();
+		for (auto &it : cell_types) {
+			it.second.inputs.settle();
+			it.second.outputs.settle();
+		}
+	}
+
 	bool cell_known(RTLIL::IdString type) const
 	{
 		return cell_types.count(type) != 0;
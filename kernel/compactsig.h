@@ -0,0 +1,545 @@
+/* -*- c++ -*-
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef COMPACTSIG_H
+#define COMPACTSIG_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// A signal with a single representation: a list of runs, each a slice of a wire, a repetition
+// of one constant state or a string of packed constant bits. Adjacent runs that can be merged
+// are always merged, so equal signals have equal runs. Constant bits that are not all the same
+// are packed with two bits per state (only 0, 1, x and z, '-' and 'm' bits are kept as runs of
+// their own). Up to two runs and 64 packed bits, which covers whole wires, wire slices, fills,
+// zero extensions and mixed constants, are stored inline without allocating. The hash of the
+// runs is kept up to date by every append, so hash() never walks the runs.
+struct CompactSigSpec
+{
+	struct run_t
+	{
+		RTLIL::Wire *wire;
+		// The first bit of the wire slice, the RTLIL::State of a constant run, or the
+		// complement (~index) of the first packed bit of a packed constant run
+		int offset;
+		int width;
+
+		bool is_packed() const {
+			return wire == nullptr && offset < 0;
+		}
+		bool operator==(const run_t &other) const {
+			return wire == other.wire && offset == other.offset && width == other.width;
+		}
+		bool operator!=(const run_t &other) const {
+			return !(*this == other);
+		}
+		unsigned int hash() const {
+			return mkhash(mkhash(wire ? wire->name.hash() : 0, offset), width);
+		}
+	};
+
+private:
+	static const int inline_runs = 2;
+	static const int inline_words = 2;
+	static const int states_per_word = 32;
+
+	run_t inline_[inline_runs];
+	run_t *heap_ = nullptr;
+	int num_runs_ = 0;
+	int capacity_ = inline_runs;
+	int width_ = 0;
+	// Hash of all runs but the last one, which may still grow
+	unsigned int prefix_hash_ = mkhash_init;
+
+	// The packed bits of all packed runs in order, unused bits are zero
+	uint64_t inline_words_[inline_words] = {};
+	uint64_t *heap_words_ = nullptr;
+	int num_states_ = 0;
+	int words_capacity_ = inline_words;
+
+	run_t *data() { return heap_ ? heap_ : inline_; }
+	const run_t *data() const { return heap_ ? heap_ : inline_; }
+	uint64_t *words() { return heap_words_ ? heap_words_ : inline_words_; }
+	const uint64_t *words() const { return heap_words_ ? heap_words_ : inline_words_; }
+	int num_words() const { return (num_states_ + states_per_word - 1) / states_per_word; }
+
+	static bool packable(RTLIL::State state) {
+		return state <= RTLIL::Sz;
+	}
+
+	RTLIL::State packed_state(int index) const {
+		return RTLIL::State((words()[index / states_per_word] >> (2 * (index % states_per_word))) & 3);
+	}
+
+	void grow()
+	{
+		int capacity = 2 * capacity_;
+		run_t *heap = new run_t[capacity];
+		std::copy(data(), data() + num_runs_, heap);
+		delete[] heap_;
+		heap_ = heap;
+		capacity_ = capacity;
+	}
+
+	void grow_words(int min_capacity)
+	{
+		int capacity = words_capacity_;
+		while (capacity < min_capacity)
+			capacity *= 2;
+		uint64_t *heap = new uint64_t[capacity]();
+		std::copy(words(), words() + num_words(), heap);
+		delete[] heap_words_;
+		heap_words_ = heap;
+		words_capacity_ = capacity;
+	}
+
+	void push_states(RTLIL::State state, int count)
+	{
+		int needed = (num_states_ + count + states_per_word - 1) / states_per_word;
+		if (needed > words_capacity_)
+			grow_words(needed);
+		uint64_t *w = words();
+		for (int i = 0; i < count; i++, num_states_++)
+			w[num_states_ / states_per_word] |= uint64_t(state) << (2 * (num_states_ % states_per_word));
+	}
+
+	void push_run(const run_t &run)
+	{
+		if (num_runs_ > 0)
+			prefix_hash_ = mkhash(prefix_hash_, data()[num_runs_ - 1].hash());
+		if (num_runs_ == capacity_)
+			grow();
+		data()[num_runs_++] = run;
+		width_ += run.width;
+	}
+
+	void append_state(RTLIL::State state, int count)
+	{
+		if (count <= 0)
+			return;
+		if (num_runs_ > 0 && data()[num_runs_ - 1].wire == nullptr) {
+			run_t &last = data()[num_runs_ - 1];
+			if (!last.is_packed() && last.offset == int(state)) {
+				last.width += count;
+				width_ += count;
+				return;
+			}
+			if (packable(state) && (last.is_packed() || packable(RTLIL::State(last.offset)))) {
+				// The last run is always the last one with packed bits, so it can grow in place
+				if (!last.is_packed()) {
+					RTLIL::State fill = RTLIL::State(last.offset);
+					last.offset = ~num_states_;
+					push_states(fill, last.width);
+				}
+				push_states(state, count);
+				last.width += count;
+				width_ += count;
+				return;
+			}
+		}
+		push_run(run_t{nullptr, int(state), count});
+	}
+
+	void append_slice(const CompactSigSpec &owner, const run_t &run, int offset, int width)
+	{
+		if (width <= 0)
+			return;
+		if (run.wire) {
+			append(run.wire, run.offset + offset, width);
+			return;
+		}
+		if (!run.is_packed()) {
+			append_state(RTLIL::State(run.offset), width);
+			return;
+		}
+		for (int i = 0; i < width; i++)
+			append_state(owner.packed_state(~run.offset + offset + i), 1);
+	}
+
+	void copy_from(const CompactSigSpec &other)
+	{
+		clear();
+		if (other.num_runs_ > capacity_) {
+			delete[] heap_;
+			heap_ = new run_t[other.capacity_];
+			capacity_ = other.capacity_;
+		}
+		if (other.num_words() > words_capacity_)
+			grow_words(other.num_words());
+		std::copy(other.data(), other.data() + other.num_runs_, data());
+		std::copy(other.words(), other.words() + other.num_words(), words());
+		num_runs_ = other.num_runs_;
+		width_ = other.width_;
+		prefix_hash_ = other.prefix_hash_;
+		num_states_ = other.num_states_;
+	}
+
+	void move_from(CompactSigSpec &other)
+	{
+		clear();
+		delete[] heap_;
+		heap_ = other.heap_;
+		capacity_ = other.capacity_;
+		if (!heap_)
+			std::copy(other.inline_, other.inline_ + other.num_runs_, inline_);
+		delete[] heap_words_;
+		heap_words_ = other.heap_words_;
+		words_capacity_ = other.words_capacity_;
+		if (!heap_words_)
+			std::copy(other.inline_words_, other.inline_words_ + inline_words, inline_words_);
+		num_runs_ = other.num_runs_;
+		width_ = other.width_;
+		prefix_hash_ = other.prefix_hash_;
+		num_states_ = other.num_states_;
+		other.heap_ = nullptr;
+		other.capacity_ = inline_runs;
+		other.heap_words_ = nullptr;
+		other.words_capacity_ = inline_words;
+		other.num_states_ = 0;
+		std::fill(other.inline_words_, other.inline_words_ + inline_words, 0);
+		other.clear();
+	}
+
+public:
+	CompactSigSpec() { }
+	CompactSigSpec(const CompactSigSpec &other) { copy_from(other); }
+	CompactSigSpec(CompactSigSpec &&other) noexcept { move_from(other); }
+	~CompactSigSpec() { delete[] heap_; delete[] heap_words_; }
+
+	CompactSigSpec(RTLIL::Wire *wire) { append(wire, 0, wire->width); }
+	CompactSigSpec(RTLIL::Wire *wire, int offset, int width) { append(wire, offset, width); }
+	CompactSigSpec(RTLIL::State state, int width = 1) { append(state, width); }
+	CompactSigSpec(const RTLIL::SigBit &bit) { append(bit); }
+	CompactSigSpec(const RTLIL::SigSpec &sig) { append(sig); }
+	CompactSigSpec(const RTLIL::Const &value) { append(value); }
+
+	CompactSigSpec &operator=(const CompactSigSpec &other) {
+		if (this != &other)
+			copy_from(other);
+		return *this;
+	}
+	CompactSigSpec &operator=(CompactSigSpec &&other) noexcept {
+		if (this != &other)
+			move_from(other);
+		return *this;
+	}
+
+	void clear() {
+		std::fill(words(), words() + num_words(), 0);
+		num_states_ = 0;
+		num_runs_ = 0;
+		width_ = 0;
+		prefix_hash_ = mkhash_init;
+	}
+
+	int size() const { return width_; }
+	bool empty() const { return width_ == 0; }
+	int num_runs() const { return num_runs_; }
+	const run_t *begin() const { return data(); }
+	const run_t *end() const { return data() + num_runs_; }
+	bool is_inline() const { return heap_ == nullptr && heap_words_ == nullptr; }
+
+	RTLIL::SigBit bit(const run_t &run, int index) const
+	{
+		if (run.wire)
+			return RTLIL::SigBit(run.wire, run.offset + index);
+		return RTLIL::SigBit(run.is_packed() ? packed_state(~run.offset + index) : RTLIL::State(run.offset));
+	}
+
+	void append(RTLIL::Wire *wire, int offset, int width) {
+		if (width <= 0)
+			return;
+		if (num_runs_ > 0) {
+			run_t &last = data()[num_runs_ - 1];
+			if (last.wire == wire && last.offset + last.width == offset) {
+				last.width += width;
+				width_ += width;
+				return;
+			}
+		}
+		push_run(run_t{wire, offset, width});
+	}
+	void append(RTLIL::State state, int width = 1) {
+		append_state(state, width);
+	}
+	void append(const RTLIL::SigBit &bit) {
+		if (bit.wire)
+			append(bit.wire, bit.offset, 1);
+		else
+			append_state(bit.data, 1);
+	}
+	void append(const CompactSigSpec &other) {
+		// Copy the runs first, the other signal may be this one
+		if (other.num_runs_ > 0 && &other == this) {
+			CompactSigSpec copy = other;
+			append(copy);
+			return;
+		}
+		for (auto &run : other)
+			append_slice(other, run, 0, run.width);
+	}
+	void append(const RTLIL::Const &value) {
+		for (auto state : value.bits)
+			append_state(state, 1);
+	}
+	void append(const RTLIL::SigSpec &sig) {
+		for (auto &chunk : sig.chunks()) {
+			if (chunk.wire)
+				append(chunk.wire, chunk.offset, chunk.width);
+			else
+				for (auto state : chunk.data)
+					append_state(state, 1);
+		}
+	}
+
+	RTLIL::SigBit operator[](int index) const
+	{
+		log_assert(0 <= index && index < width_);
+		for (auto &run : *this) {
+			if (index < run.width)
+				return bit(run, index);
+			index -= run.width;
+		}
+		log_abort();
+	}
+
+	CompactSigSpec extract(int offset, int length = 1) const
+	{
+		log_assert(offset >= 0 && length >= 0 && offset + length <= width_);
+		CompactSigSpec result;
+		for (auto &run : *this) {
+			if (length == 0)
+				break;
+			if (offset >= run.width) {
+				offset -= run.width;
+				continue;
+			}
+			int width = min(run.width - offset, length);
+			result.append_slice(*this, run, offset, width);
+			offset = 0;
+			length -= width;
+		}
+		return result;
+	}
+
+	// Replaces every bit that is a key of the map, like SigSpec::replace()
+	void replace(const dict<RTLIL::SigBit, RTLIL::SigBit> &rules)
+	{
+		pool<RTLIL::Wire*> wires;
+		bool const_keys = false;
+		for (auto &it : rules) {
+			if (it.first.wire)
+				wires.insert(it.first.wire);
+			else
+				const_keys = true;
+		}
+
+		auto affected = [&](const run_t &run) {
+			return run.wire ? wires.count(run.wire) != 0 : const_keys;
+		};
+		if (std::none_of(begin(), end(), affected))
+			return;
+
+		CompactSigSpec result;
+		for (auto &run : *this) {
+			if (!affected(run)) {
+				result.append_slice(*this, run, 0, run.width);
+				continue;
+			}
+			for (int i = 0; i < run.width; i++) {
+				RTLIL::SigBit bit = this->bit(run, i);
+				auto it = rules.find(bit);
+				result.append(it == rules.end() ? bit : it->second);
+			}
+		}
+		*this = std::move(result);
+	}
+
+	// Replaces every bit of the pattern with the bit at the same index of with, constant bits
+	// of the pattern are ignored and the first occurrence of a bit wins like in SigSpec::replace()
+	void replace(const CompactSigSpec &pattern, const CompactSigSpec &with)
+	{
+		log_assert(pattern.size() == with.size());
+		if (!overlaps(pattern))
+			return;
+
+		std::vector<RTLIL::SigBit> with_bits = with.bits();
+		dict<RTLIL::SigBit, RTLIL::SigBit> rules;
+		int index = 0;
+		for (auto &run : pattern)
+			for (int i = 0; i < run.width; i++, index++)
+				if (run.wire)
+					rules.emplace(pattern.bit(run, i), with_bits[index]);
+		replace(rules);
+	}
+
+	// Sorts the bits like SigSpec::sort()
+	void sort()
+	{
+		std::vector<RTLIL::SigBit> sorted = bits();
+		std::sort(sorted.begin(), sorted.end());
+		CompactSigSpec result;
+		for (auto &bit : sorted)
+			result.append(bit);
+		*this = std::move(result);
+	}
+
+	// Sorts the bits like SigSpec::sort_and_unify() and removes duplicates. This works on the
+	// runs: the slices of every wire are sorted and overlapping slices are merged.
+	void sort_and_unify()
+	{
+		bool states[RTLIL::Sm + 1] = {};
+		std::vector<run_t> runs;
+		for (auto &run : *this) {
+			if (run.wire)
+				runs.push_back(run);
+			else if (!run.is_packed())
+				states[run.offset] = true;
+			else
+				for (int i = 0; i < run.width; i++)
+					states[packed_state(~run.offset + i)] = true;
+		}
+		std::sort(runs.begin(), runs.end(), [](const run_t &a, const run_t &b) {
+			if (a.wire == b.wire)
+				return a.offset < b.offset;
+			return a.wire->name < b.wire->name;
+		});
+
+		// Constant bits sort before wire bits
+		CompactSigSpec result;
+		for (int state = RTLIL::S0; state <= RTLIL::Sm; state++)
+			if (states[state])
+				result.append_state(RTLIL::State(state), 1);
+		for (auto &run : runs) {
+			if (result.num_runs_ > 0) {
+				const run_t &last = result.data()[result.num_runs_ - 1];
+				if (last.wire == run.wire) {
+					int last_end = last.offset + last.width;
+					if (run.offset + run.width <= last_end)
+						continue;
+					if (run.offset < last_end) {
+						result.append(run.wire, last_end, run.offset + run.width - last_end);
+						continue;
+					}
+				}
+			}
+			result.append(run.wire, run.offset, run.width);
+		}
+		*this = std::move(result);
+	}
+
+	// Whether any wire bit of the other signal is also a bit of this one
+	bool overlaps(const CompactSigSpec &other) const
+	{
+		for (auto &run : *this) {
+			if (!run.wire)
+				continue;
+			for (auto &other_run : other)
+				if (other_run.wire == run.wire && other_run.offset < run.offset + run.width &&
+						run.offset < other_run.offset + other_run.width)
+					return true;
+		}
+		return false;
+	}
+
+	bool is_fully_const() const
+	{
+		for (auto &run : *this)
+			if (run.wire)
+				return false;
+		return true;
+	}
+
+	bool is_wire() const
+	{
+		return num_runs_ == 1 && data()[0].wire && data()[0].offset == 0 && data()[0].width == data()[0].wire->width;
+	}
+
+	std::vector<RTLIL::SigBit> bits() const
+	{
+		std::vector<RTLIL::SigBit> result;
+		result.reserve(width_);
+		for (auto &run : *this)
+			for (int i = 0; i < run.width; i++)
+				result.push_back(bit(run, i));
+		return result;
+	}
+
+	RTLIL::SigSpec to_sigspec() const
+	{
+		RTLIL::SigSpec sig;
+		for (auto &run : *this) {
+			if (run.wire) {
+				sig.append(RTLIL::SigChunk(run.wire, run.offset, run.width));
+			} else if (!run.is_packed()) {
+				sig.append(RTLIL::Const(RTLIL::State(run.offset), run.width));
+			} else {
+				std::vector<RTLIL::State> states;
+				for (int i = 0; i < run.width; i++)
+					states.push_back(packed_state(~run.offset + i));
+				sig.append(RTLIL::Const(states));
+			}
+		}
+		return sig;
+	}
+
+	bool operator==(const CompactSigSpec &other) const
+	{
+		if (width_ != other.width_ || num_runs_ != other.num_runs_ || prefix_hash_ != other.prefix_hash_ ||
+				num_states_ != other.num_states_)
+			return false;
+		return std::equal(begin(), end(), other.begin()) &&
+				std::equal(words(), words() + num_words(), other.words());
+	}
+	bool operator!=(const CompactSigSpec &other) const {
+		return !(*this == other);
+	}
+
+	// An arbitrary but deterministic order, e.g. to normalize the inputs of commutative cells
+	bool operator<(const CompactSigSpec &other) const
+	{
+		if (width_ != other.width_)
+			return width_ < other.width_;
+		if (num_runs_ != other.num_runs_)
+			return num_runs_ < other.num_runs_;
+		for (int i = 0; i < num_runs_; i++) {
+			const run_t &a = data()[i], &b = other.data()[i];
+			if (a.wire != b.wire)
+				return a.wire == nullptr || (b.wire != nullptr && a.wire->name < b.wire->name);
+			if (a.offset != b.offset)
+				return a.offset < b.offset;
+			if (a.width != b.width)
+				return a.width < b.width;
+		}
+		return std::lexicographical_compare(words(), words() + num_words(), other.words(), other.words() + other.num_words());
+	}
+
+	unsigned int hash() const
+	{
+		unsigned int h = num_runs_ == 0 ? prefix_hash_ : mkhash(prefix_hash_, data()[num_runs_ - 1].hash());
+		for (int i = 0; i < num_words(); i++)
+			h = mkhash(mkhash(h, uint32_t(words()[i])), uint32_t(words()[i] >> 32));
+		return h;
+	}
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
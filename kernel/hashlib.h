@@ -660,6 +660,13 @@ public:
 	bool empty() const { return entries.empty(); }
 	void clear() { hashtable.clear(); entries.clear(); }
 
+	// Lookups rebuild a hashtable that has fallen behind the entries. Do it now, so that
+	// threads can look up keys concurrently as long as nobody modifies the container.
+	void settle() const {
+		if (!hashtable.empty() && entries.size() * hashtable_size_trigger > hashtable.size())
+			((dict*)this)->do_rehash();
+	}
+
 	iterator begin() { return iterator(this, int(entries.size())-1); }
 	iterator element(int n) { return iterator(this, int(entries.size())-1-n); }
 	iterator end() { return iterator(nullptr, -1); }
@@ -1026,6 +1033,13 @@ public:
 	bool empty() const { return entries.empty(); }
 	void clear() { hashtable.clear(); entries.clear(); }
 
+	// Lookups rebuild a hashtable that has fallen behind the entries. Do it now, so that
+	// threads can look up keys concurrently as long as nobody modifies the container.
+	void settle() const {
+		if (!hashtable.empty() && entries.size() * hashtable_size_trigger > hashtable.size())
+			((pool*)this)->do_rehash();
+	}
+
 	iterator begin() { return iterator(this, int(entries.size())-1); }
 	iterator element(int n) { return iterator(this, int(entries.size())-1-n); }
 	iterator end() { return iterator(nullptr, -1); }
@@ -63,7 +63,7 @@ void (*log_verific_callback)(int msg_type, const char *message_id, const char* f
 
 int log_make_debug = 0;
 int log_force_debug = 0;
-int log_debug_suppressed = 0;
+thread_local int log_debug_suppressed = 0;
 
 vector<int> header_count;
 vector<char*> log_id_cache;
@@ -74,6 +74,8 @@ static struct timeval initial_tv = { 0, 0 };
 static bool next_print_log = false;
 static int log_newline_count = 0;
 
+static thread_local LogBuffer *log_thread_buffer = nullptr;
+
 static void log_id_cache_clear()
 {
 	for (auto p : log_id_cache)
@@ -116,6 +118,11 @@ void logv(const char *format, va_list ap)
 	if (str.empty())
 		return;
 
+	if (log_thread_buffer) {
+		log_thread_buffer->entries.push_back(LogBuffer::entry_t{LogBuffer::MESSAGE, std::string(), str});
+		return;
+	}
+
 	size_t nnl_pos = str.find_last_not_of('\n');
 	if (nnl_pos == std::string::npos)
 		log_newline_count += GetSize(str);
@@ -248,6 +255,11 @@ static void logv_warning_with_prefix(const char *prefix,
 	std::string message = vstringf(format, ap);
 	bool suppressed = false;
 
+	if (log_thread_buffer) {
+		log_thread_buffer->entries.push_back(LogBuffer::entry_t{LogBuffer::WARNING, prefix, message});
+		return;
+	}
+
 	for (auto &re : log_nowarn_regexes)
 		if (std::regex_search(message, re))
 			suppressed = true;
@@ -298,6 +310,14 @@ static void logv_warning_with_prefix(const char *prefix,
 	}
 }
 
+static void log_warning_with_prefix(const char *prefix, const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	logv_warning_with_prefix(prefix, format, ap);
+	va_end(ap);
+}
+
 void logv_warning(const char *format, va_list ap)
 {
 	logv_warning_with_prefix("Warning: ", format, ap);
@@ -334,6 +354,11 @@ void log_file_info(const std::string &filename, int lineno,
 static void logv_error_with_prefix(const char *prefix,
                                    const char *format, va_list ap)
 {
+	if (log_thread_buffer) {
+		log_thread_buffer->entries.push_back(LogBuffer::entry_t{LogBuffer::ERROR, prefix, vstringf(format, ap)});
+		throw log_buffer_error_exception();
+	}
+
 #ifdef EMSCRIPTEN
 	auto backup_log_files = log_files;
 #endif
@@ -379,6 +404,14 @@ static void logv_error_with_prefix(const char *prefix,
 #endif
 }
 
+[[noreturn]]
+static void log_error_with_prefix(const char *prefix, const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	logv_error_with_prefix(prefix, format, ap);
+}
+
 void logv_error(const char *format, va_list ap)
 {
 	logv_error_with_prefix("ERROR: ", format, ap);
@@ -457,6 +490,12 @@ void log_cmd_error(const char *format, ...)
 	va_list ap;
 	va_start(ap, format);
 
+	if (log_thread_buffer) {
+		log_thread_buffer->entries.push_back(LogBuffer::entry_t{LogBuffer::CMD_ERROR, std::string(), vstringf(format, ap)});
+		va_end(ap);
+		throw log_buffer_error_exception();
+	}
+
 	if (log_cmd_error_throw) {
 		log_last_error = vstringf(format, ap);
 		log("ERROR: %s", log_last_error.c_str());
@@ -467,6 +506,45 @@ void log_cmd_error(const char *format, ...)
 	logv_error(format, ap);
 }
 
+void log_buffer_begin(LogBuffer *buffer)
+{
+	log_assert(log_thread_buffer == nullptr);
+	log_thread_buffer = buffer;
+}
+
+void log_buffer_end()
+{
+	log_assert(log_thread_buffer != nullptr);
+	log_thread_buffer->debug_suppressed += log_debug_suppressed;
+	log_debug_suppressed = 0;
+	log_thread_buffer = nullptr;
+}
+
+void log_buffer_flush(LogBuffer &buffer)
+{
+	log_assert(log_thread_buffer == nullptr);
+	log_debug_suppressed += buffer.debug_suppressed;
+
+	std::vector<LogBuffer::entry_t> entries;
+	std::swap(entries, buffer.entries);
+	buffer.strings.clear();
+	buffer.debug_suppressed = 0;
+
+	for (auto &entry : entries)
+		switch (entry.kind) {
+		case LogBuffer::MESSAGE:
+			log("%s", entry.text.c_str());
+			break;
+		case LogBuffer::WARNING:
+			log_warning_with_prefix(entry.prefix.c_str(), "%s", entry.text.c_str());
+			break;
+		case LogBuffer::ERROR:
+			log_error_with_prefix(entry.prefix.c_str(), "%s", entry.text.c_str());
+		case LogBuffer::CMD_ERROR:
+			log_cmd_error("%s", entry.text.c_str());
+		}
+}
+
 void log_spacer()
 {
 	if (log_newline_count < 2) log("\n");
@@ -596,6 +674,9 @@ void log_reset_stack()
 
 void log_flush()
 {
+	if (log_thread_buffer)
+		return;
+
 	for (auto f : log_files)
 		fflush(f);
 
@@ -620,6 +701,11 @@ const char *log_signal(const RTLIL::SigSpec &sig, bool autoint)
 	std::stringstream buf;
 	RTLIL_BACKEND::dump_sigspec(buf, sig, autoint);
 
+	if (log_thread_buffer) {
+		log_thread_buffer->strings.push_back(buf.str());
+		return log_thread_buffer->strings.back().c_str();
+	}
+
 	if (string_buf.size() < 100) {
 		string_buf.push_back(buf.str());
 		return string_buf.back().c_str();
@@ -638,6 +724,11 @@ const char *log_const(const RTLIL::Const &value, bool autoint)
 
 	std::string str = "\"" + value.decode_string() + "\"";
 
+	if (log_thread_buffer) {
+		log_thread_buffer->strings.push_back(str);
+		return log_thread_buffer->strings.back().c_str();
+	}
+
 	if (string_buf.size() < 100) {
 		string_buf.push_back(str);
 		return string_buf.back().c_str();
@@ -651,8 +742,14 @@ const char *log_const(const RTLIL::Const &value, bool autoint)
 
 const char *log_id(const RTLIL::IdString &str)
 {
-	log_id_cache.push_back(strdup(str.c_str()));
-	const char *p = log_id_cache.back();
+	const char *p;
+	if (log_thread_buffer) {
+		log_thread_buffer->strings.push_back(str.str());
+		p = log_thread_buffer->strings.back().c_str();
+	} else {
+		log_id_cache.push_back(strdup(str.c_str()));
+		p = log_id_cache.back();
+	}
 	if (p[0] != '\\')
 		return p;
 	if (p[1] == '$' || p[1] == '\\' || p[1] == 0)
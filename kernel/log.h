@@ -25,6 +25,7 @@
 #include <time.h>
 
 #include <regex>
+#include <deque>
 #define YS_REGEX_COMPILE(param) std::regex(param, \
 				std::regex_constants::nosubs | \
 				std::regex_constants::optimize | \
@@ -94,6 +95,23 @@ YOSYS_NAMESPACE_BEGIN
 
 struct log_cmd_error_exception { };
 
+// Thrown by log_error() and log_cmd_error() on a thread with an active log buffer. The
+// error itself is recorded in the buffer and raised again by log_buffer_flush().
+struct log_buffer_error_exception { };
+
+// The log output of a worker thread. While a buffer is active on a thread, everything that
+// thread logs is recorded in the buffer instead of being written, so that the main thread
+// can write the output of several workers in a deterministic order with log_buffer_flush().
+struct LogBuffer
+{
+	enum kind_t { MESSAGE, WARNING, ERROR, CMD_ERROR };
+	struct entry_t { kind_t kind; std::string prefix, text; };
+
+	std::vector<entry_t> entries;
+	std::deque<std::string> strings;
+	int debug_suppressed = 0;
+};
+
 extern std::vector<FILE*> log_files;
 extern std::vector<std::ostream*> log_streams;
 extern std::vector<std::string> log_scratchpads;
@@ -117,7 +135,7 @@ extern void (*log_error_atexit)();
 
 extern int log_make_debug;
 extern int log_force_debug;
-extern int log_debug_suppressed;
+extern thread_local int log_debug_suppressed;
 
 void logv(const char *format, va_list ap);
 void logv_header(RTLIL::Design *design, const char *format, va_list ap);
@@ -126,6 +144,10 @@ void logv_warning_noprefix(const char *format, va_list ap);
 [[noreturn]] void logv_error(const char *format, va_list ap);
 [[noreturn]] void logv_file_error(const string &filename, int lineno, const char *format, va_list ap);
 
+void log_buffer_begin(LogBuffer *buffer);
+void log_buffer_end();
+void log_buffer_flush(LogBuffer &buffer);
+
 void log(const char *format, ...)  YS_ATTRIBUTE(format(printf, 1, 2));
 void log_header(RTLIL::Design *design, const char *format, ...) YS_ATTRIBUTE(format(printf, 2, 3));
 void log_warning(const char *format, ...) YS_ATTRIBUTE(format(printf, 1, 2));
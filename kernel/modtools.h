@@ -387,6 +387,13 @@ struct ModWalker
 			setup(module);
 	}
 
+	// Reuses the cell types of the design, which are the same for all its modules
+	ModWalker(RTLIL::Design *design, const CellTypes &ct, RTLIL::Module *module) : design(design), module(NULL)
+	{
+		this->ct = ct;
+		setup(module);
+	}
+
 	void setup(RTLIL::Module *module, CellTypes *filter_ct = NULL)
 	{
 		this->module = module;
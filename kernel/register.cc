@@ -19,12 +19,19 @@
 
 #include "kernel/yosys.h"
 #include "kernel/satgen.h"
+#include "kernel/celltypes.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
 
+#ifdef YOSYS_ENABLE_THREADS
+#  include <atomic>
+#  include <exception>
+#  include <thread>
+#endif
+
 #ifdef YOSYS_ENABLE_ZLIB
 #include <zlib.h>
 
@@ -439,6 +446,137 @@ void ScriptPass::help_script()
 	script();
 }
 
+int ParallelModulePass::num_threads = 1;
+
+#ifdef YOSYS_ENABLE_THREADS
+// The height of a module in the hierarchy of the processed modules, every module has a larger
+// height than all the processed modules it instantiates
+static int module_height(RTLIL::Module *module, const pool<RTLIL::Module*> &processed, dict<RTLIL::Module*, int> &heights)
+{
+	auto it = heights.find(module);
+	if (it != heights.end())
+		return it->second;
+
+	// Set before recursing, so that a recursive hierarchy can not loop forever
+	heights[module] = 0;
+	int height = 0;
+	for (auto cell : module->cells()) {
+		RTLIL::Module *submodule = module->design->module(cell->type);
+		if (submodule != nullptr && submodule != module && processed.count(submodule))
+			height = max(height, module_height(submodule, processed, heights) + 1);
+	}
+	heights[module] = height;
+	return height;
+}
+
+// Lookups in hashlib containers rehash lazily, which must not happen in containers that
+// several workers read at the same time
+static void settle_shared_tables(RTLIL::Design *design)
+{
+	design->modules_.settle();
+	design->monitors.settle();
+	for (auto &selection : design->selection_stack) {
+		selection.selected_modules.settle();
+		selection.selected_members.settle();
+		for (auto &it : selection.selected_members)
+			it.second.settle();
+	}
+	for (auto module : design->modules()) {
+		module->wires_.settle();
+		module->cells_.settle();
+		module->attributes.settle();
+	}
+	yosys_celltypes.settle();
+	RTLIL::builtin_ff_cell_types().settle();
+}
+#endif
+
+void ParallelModulePass::execute_modules(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules,
+		std::function<void(RTLIL::Module *module, int index)> body)
+{
+#if defined(YOSYS_ENABLE_THREADS) && !defined(WITH_PYTHON)
+	int threads = min(num_threads, GetSize(modules));
+#else
+	int threads = 1;
+#endif
+
+	if (threads <= 1) {
+		for (int i = 0; i < GetSize(modules); i++)
+			body(modules[i], i);
+		return;
+	}
+
+#ifdef YOSYS_ENABLE_THREADS
+	// Modules are processed in waves of equal height, so that no worker reads the ports of
+	// a module while another worker modifies it. Within a wave the largest modules go first.
+	pool<RTLIL::Module*> processed(modules.begin(), modules.end());
+	dict<RTLIL::Module*, int> heights;
+	std::vector<std::vector<int>> waves;
+	for (int i = 0; i < GetSize(modules); i++) {
+		int height = module_height(modules[i], processed, heights);
+		if (height >= GetSize(waves))
+			waves.resize(height + 1);
+		waves[height].push_back(i);
+	}
+	for (auto &wave : waves)
+		std::stable_sort(wave.begin(), wave.end(), [&](int a, int b) {
+			return GetSize(modules[a]->cells_) + GetSize(modules[a]->wires_) > GetSize(modules[b]->cells_) + GetSize(modules[b]->wires_);
+		});
+
+	settle_shared_tables(design);
+
+	std::vector<LogBuffer> buffers(GetSize(modules));
+	std::vector<std::exception_ptr> errors(GetSize(modules));
+	std::atomic<bool> failed(false);
+
+	RTLIL::IdString::begin_parallel();
+	for (auto &wave : waves) {
+		// Every idle worker takes the next module of the wave, so one large module does not
+		// hold back the others
+		std::atomic<int> next_index(0);
+		auto worker = [&]() {
+			while (!failed) {
+				int index = next_index++;
+				if (index >= GetSize(wave))
+					break;
+				int i = wave[index];
+				log_buffer_begin(&buffers[i]);
+				try {
+					body(modules[i], i);
+				} catch (...) {
+					errors[i] = std::current_exception();
+					failed = true;
+				}
+				log_buffer_end();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (int t = 1; t < min(threads, GetSize(wave)); t++)
+			workers.emplace_back(worker);
+		worker();
+		for (auto &thread : workers)
+			thread.join();
+
+		if (failed)
+			break;
+		for (int i : wave) {
+			modules[i]->wires_.settle();
+			modules[i]->cells_.settle();
+			modules[i]->attributes.settle();
+		}
+	}
+	RTLIL::IdString::end_parallel();
+
+	// A recorded log_error() is raised again by the flush, other exceptions are rethrown
+	for (int i = 0; i < GetSize(modules); i++) {
+		log_buffer_flush(buffers[i]);
+		if (errors[i])
+			std::rethrow_exception(errors[i]);
+	}
+#endif
+}
+
 Frontend::Frontend(std::string name, std::string short_help) :
 		Pass(name.rfind("=", 0) == 0 ? name.substr(1) : "read_" + name, short_help),
 		frontend_name(name.rfind("=", 0) == 0 ? name.substr(1) : name)
@@ -984,12 +1122,17 @@ struct EchoPass : public Pass {
 
 SatSolver *yosys_satsolver_list;
 SatSolver *yosys_satsolver;
+SatPortfolio yosys_sat_portfolio;
 
 struct MinisatSatSolver : public SatSolver {
 	MinisatSatSolver() : SatSolver("minisat") {
 		yosys_satsolver = this;
 	}
 	ezSAT *create() override {
+#ifdef YOSYS_ENABLE_THREADS
+		if (yosys_sat_portfolio.num_solvers > 1)
+			return new ezPortfolioSAT(yosys_sat_portfolio.num_solvers, yosys_sat_portfolio.share_size);
+#endif
 		return new ezMiniSAT();
 	}
 } MinisatSatSolver;
@@ -89,6 +89,21 @@ struct ScriptPass : Pass
 	void help_script();
 };
 
+struct ParallelModulePass : Pass
+{
+	// Number of worker threads of execute_modules(), see the `threads` command
+	static int num_threads;
+
+	ParallelModulePass(std::string name, std::string short_help = "** document me **") : Pass(name, short_help) { }
+
+	// Calls body(module, index) for every module. With more than one thread the modules are
+	// processed concurrently, so the body must only modify the given module and only read
+	// the ports and attributes of other modules. Its log output is buffered per module and
+	// written in the order of the modules once all of them are done.
+	void execute_modules(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules,
+			std::function<void(RTLIL::Module *module, int index)> body);
+};
+
 struct Frontend : Pass
 {
 	// for reading of here documents
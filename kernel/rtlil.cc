@@ -21,12 +21,18 @@
 #include "kernel/macc.h"
 #include "kernel/celltypes.h"
 #include "kernel/binding.h"
+#include "kernel/arena.h"
+#include "kernel/sigtools.h"
 #include "frontends/verilog/verilog_frontend.h"
 #include "frontends/verilog/preproc.h"
 #include "backends/rtlil/rtlil_backend.h"
 
 #include <string.h>
 #include <algorithm>
+#ifdef YOSYS_ENABLE_THREADS
+#  include <atomic>
+#  include <mutex>
+#endif
 
 YOSYS_NAMESPACE_BEGIN
 
@@ -42,6 +48,201 @@ std::vector<int> RTLIL::IdString::global_free_idx_list_;
 int RTLIL::IdString::last_created_idx_[8];
 int RTLIL::IdString::last_created_idx_ptr_;
 #endif
+bool RTLIL::IdString::parallel_ = false;
+
+// New IdStrings of a parallel region are spread over a fixed number of shards by the hash of
+// the name, so that threads creating different names rarely wait for each other
+#define ID_PARALLEL_SHARDS 64
+
+struct id_parallel_shard_t {
+#ifdef YOSYS_ENABLE_THREADS
+	std::mutex mutex;
+#endif
+	dict<char*, int, hash_cstr_ops> index;
+};
+
+static id_parallel_shard_t id_parallel_shards[ID_PARALLEL_SHARDS];
+// New IdStrings of a parallel region are numbered from the size of the storage at the start of
+// the region and kept in segments that are allocated on demand and never move, end_parallel()
+// appends them to the storage. The segments are kept for later regions.
+#define ID_PARALLEL_SEGMENT_BITS 16
+#define ID_PARALLEL_SEGMENTS (0x40000000 >> ID_PARALLEL_SEGMENT_BITS)
+
+#ifdef YOSYS_ENABLE_THREADS
+static std::atomic<int> id_parallel_next_idx;
+static std::atomic<char**> id_parallel_segments[ID_PARALLEL_SEGMENTS];
+#else
+static int id_parallel_next_idx;
+static char **id_parallel_segments[ID_PARALLEL_SEGMENTS];
+#endif
+static int id_parallel_begin_idx;
+
+static char *&id_parallel_slot(int idx)
+{
+	int offset = idx - id_parallel_begin_idx;
+	char **segment = id_parallel_segments[offset >> ID_PARALLEL_SEGMENT_BITS];
+	return segment[offset & ((1 << ID_PARALLEL_SEGMENT_BITS) - 1)];
+}
+
+#ifndef YOSYS_NO_IDS_REFCNT
+// The references a thread takes and releases within a parallel region. A thread that ends
+// within the region hands its counts over, end_parallel() applies all of them.
+struct id_parallel_refcounts_t {
+	dict<int, int> deltas;
+	~id_parallel_refcounts_t();
+};
+
+static dict<int, int> id_parallel_finished_deltas;
+#ifdef YOSYS_ENABLE_THREADS
+static std::mutex id_parallel_finished_mutex;
+static thread_local id_parallel_refcounts_t id_parallel_refcounts;
+#else
+static id_parallel_refcounts_t id_parallel_refcounts;
+#endif
+
+id_parallel_refcounts_t::~id_parallel_refcounts_t()
+{
+	if (deltas.empty())
+		return;
+#ifdef YOSYS_ENABLE_THREADS
+	std::lock_guard<std::mutex> lock(id_parallel_finished_mutex);
+#endif
+	for (auto &it : deltas)
+		id_parallel_finished_deltas[it.first] += it.second;
+}
+#endif
+
+void RTLIL::IdString::count_reference_parallel(int idx, int delta)
+{
+#ifndef YOSYS_NO_IDS_REFCNT
+	id_parallel_refcounts.deltas[idx] += delta;
+#else
+	(void)idx, (void)delta;
+#endif
+}
+
+int RTLIL::IdString::get_reference_parallel(const char *p)
+{
+	if (!p[0])
+		return 0;
+
+	// The global index is not modified within the region, so it is safe to read without a lock
+	auto it = global_id_index_.find((char*)p);
+	if (it != global_id_index_.end()) {
+		count_reference_parallel(it->second, 1);
+		return it->second;
+	}
+
+	id_parallel_shard_t &shard = id_parallel_shards[hash_cstr_ops::hash(p) % ID_PARALLEL_SHARDS];
+#ifdef YOSYS_ENABLE_THREADS
+	std::lock_guard<std::mutex> lock(shard.mutex);
+#endif
+	auto shard_it = shard.index.find((char*)p);
+	if (shard_it != shard.index.end()) {
+		count_reference_parallel(shard_it->second, 1);
+		return shard_it->second;
+	}
+
+	log_assert(p[0] == '$' || p[0] == '\\');
+	log_assert(p[1] != 0);
+	for (const char *c = p; *c; c++)
+		if ((unsigned)*c <= (unsigned)' ')
+			log_error("Found control character or space (0x%02x) in string '%s' which is not allowed in RTLIL identifiers\n", *c, p);
+
+	int idx = id_parallel_next_idx++;
+	log_assert(idx < 0x40000000);
+
+	// A new segment is installed by exactly one thread, the others release their copy
+	int segment_idx = (idx - id_parallel_begin_idx) >> ID_PARALLEL_SEGMENT_BITS;
+	if (id_parallel_segments[segment_idx] == nullptr) {
+		char **segment = new char*[1 << ID_PARALLEL_SEGMENT_BITS];
+	#ifdef YOSYS_ENABLE_THREADS
+		char **expected = nullptr;
+		if (!id_parallel_segments[segment_idx].compare_exchange_strong(expected, segment))
+			delete[] segment;
+	#else
+		id_parallel_segments[segment_idx] = segment;
+	#endif
+	}
+
+	char *str = strdup(p);
+	id_parallel_slot(idx) = str;
+	shard.index[str] = idx;
+	count_reference_parallel(idx, 1);
+	return idx;
+}
+
+const char *RTLIL::IdString::c_str_parallel(int idx)
+{
+	log_assert(parallel_ && idx >= id_parallel_begin_idx && idx < id_parallel_next_idx);
+	return id_parallel_slot(idx);
+}
+
+void RTLIL::IdString::begin_parallel()
+{
+	log_assert(destruct_guard_ok);
+	log_assert(!parallel_);
+
+	if (global_id_storage_.empty()) {
+	#ifndef YOSYS_NO_IDS_REFCNT
+		global_refcount_storage_.push_back(0);
+	#endif
+		global_id_storage_.push_back((char*)"");
+		global_id_index_[global_id_storage_.back()] = 0;
+	}
+
+	// Lookups rehash the index lazily, do it now rather than in a reading thread
+	global_id_index_.find((char*)"");
+
+	id_parallel_begin_idx = GetSize(global_id_storage_);
+	id_parallel_next_idx = id_parallel_begin_idx;
+	parallel_ = true;
+}
+
+void RTLIL::IdString::end_parallel()
+{
+	log_assert(parallel_);
+	parallel_ = false;
+
+	for (auto &shard : id_parallel_shards) {
+		for (auto &it : shard.index)
+			global_id_index_[it.first] = it.second;
+		shard.index.clear();
+	}
+
+	int size = id_parallel_next_idx;
+	global_id_storage_.reserve(size);
+	for (int idx = id_parallel_begin_idx; idx < size; idx++)
+		global_id_storage_.push_back(id_parallel_slot(idx));
+#ifndef YOSYS_NO_IDS_REFCNT
+	global_refcount_storage_.resize(size, 0);
+
+	dict<int, int> deltas;
+	{
+	#ifdef YOSYS_ENABLE_THREADS
+		std::lock_guard<std::mutex> lock(id_parallel_finished_mutex);
+	#endif
+		deltas.swap(id_parallel_finished_deltas);
+	}
+	for (auto &it : id_parallel_refcounts.deltas)
+		deltas[it.first] += it.second;
+	id_parallel_refcounts.deltas.clear();
+
+	// Strings are freed in the order of their indices, so that the free list does not depend
+	// on the order in which the threads finished
+	std::vector<int> unreferenced;
+	for (auto &it : deltas) {
+		int &refcount = global_refcount_storage_[it.first];
+		refcount += it.second;
+		log_assert(refcount >= 0);
+		if (refcount == 0)
+			unreferenced.push_back(it.first);
+	}
+	std::sort(unreferenced.begin(), unreferenced.end(), std::greater<int>());
+	for (int idx : unreferenced)
+		free_reference(idx);
+#endif
+}
 
 #define X(_id) IdString RTLIL::ID::_id;
 #include "kernel/constids.inc"
@@ -49,6 +250,21 @@ int RTLIL::IdString::last_created_idx_ptr_;
 
 dict<std::string, std::string> RTLIL::constpad;
 
+// Cells and wires are also created by the worker threads of a ParallelModulePass
+static unsigned int next_hashidx(unsigned int &hashidx_count)
+{
+#if defined(YOSYS_ENABLE_THREADS) && (defined(__GNUC__) || defined(__clang__))
+	unsigned int old_hashidx = __atomic_load_n(&hashidx_count, __ATOMIC_RELAXED), new_hashidx;
+	do
+		new_hashidx = mkhash_xorshift(old_hashidx);
+	while (!__atomic_compare_exchange_n(&hashidx_count, &old_hashidx, new_hashidx, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return new_hashidx;
+#else
+	hashidx_count = mkhash_xorshift(hashidx_count);
+	return hashidx_count;
+#endif
+}
+
 const pool<IdString> &RTLIL::builtin_ff_cell_types() {
 	static const pool<IdString> res = {
 		ID($sr),
@@ -621,8 +837,7 @@ RTLIL::Design::Design()
   : verilog_defines (new define_map_t)
 {
 	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	hashidx_ = next_hashidx(hashidx_count);
 
 	refcount_modules_ = 0;
 	selection_stack.push_back(RTLIL::Selection());
@@ -918,16 +1133,73 @@ std::vector<RTLIL::Module*> RTLIL::Design::selected_whole_modules_warn(bool incl
 	return result;
 }
 
+bool RTLIL::Module::use_arena = false;
+
+// Applies every new connection to the SigMap of a module, and drops the SigMap when the
+// connections are replaced as a whole
+struct ModuleSigMapMonitor : RTLIL::Monitor
+{
+	RTLIL::Module *module;
+
+	ModuleSigMapMonitor(RTLIL::Module *module) : module(module) { }
+
+	void notify_connect(RTLIL::Module *mod, const RTLIL::SigSig &sigsig) override
+	{
+		log_assert(module == mod);
+		// connect() drops the bits with constant left hand sides and notifies again
+		if (!module->sigmap_valid_ || sigsig.first.has_const())
+			return;
+		module->sigmap_->add(sigsig.first, sigsig.second);
+	}
+
+	void notify_connect(RTLIL::Module *mod, const std::vector<RTLIL::SigSig>&) override
+	{
+		log_assert(module == mod);
+		module->invalidate_sigmap();
+	}
+
+	void notify_blackout(RTLIL::Module *mod) override
+	{
+		log_assert(module == mod);
+		module->invalidate_sigmap();
+	}
+};
+
+const SigMap &RTLIL::Module::sigmap()
+{
+	if (sigmap_ == nullptr) {
+		sigmap_ = new SigMap;
+		sigmap_monitor_ = new ModuleSigMapMonitor(this);
+		monitors.insert(sigmap_monitor_);
+	}
+	if (!sigmap_valid_) {
+		sigmap_->set(this);
+		sigmap_valid_ = true;
+	}
+	return *sigmap_;
+}
+
+void RTLIL::Module::invalidate_sigmap()
+{
+	sigmap_valid_ = false;
+}
+
 RTLIL::Module::Module()
 {
 	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	hashidx_ = next_hashidx(hashidx_count);
 
 	design = nullptr;
 	refcount_wires_ = 0;
 	refcount_cells_ = 0;
 
+	wire_arena_ = use_arena ? new SlabArena(sizeof(RTLIL::Wire)) : nullptr;
+	cell_arena_ = use_arena ? new SlabArena(sizeof(RTLIL::Cell)) : nullptr;
+
+	sigmap_ = nullptr;
+	sigmap_monitor_ = nullptr;
+	sigmap_valid_ = false;
+
 #ifdef WITH_PYTHON
 	RTLIL::Module::get_all_modules()->insert(std::pair<unsigned int, RTLIL::Module*>(hashidx_, this));
 #endif
@@ -935,16 +1207,27 @@ RTLIL::Module::Module()
 
 RTLIL::Module::~Module()
 {
+	// objects in the arenas are only destructed, their slabs are released at once below
 	for (auto &pr : wires_)
-		delete pr.second;
+		if (wire_arena_)
+			pr.second->~Wire();
+		else
+			delete pr.second;
 	for (auto &pr : memories)
 		delete pr.second;
 	for (auto &pr : cells_)
-		delete pr.second;
+		if (cell_arena_)
+			pr.second->~Cell();
+		else
+			delete pr.second;
 	for (auto &pr : processes)
 		delete pr.second;
 	for (auto binding : bindings_)
 		delete binding;
+	delete wire_arena_;
+	delete cell_arena_;
+	delete sigmap_;
+	delete sigmap_monitor_;
 #ifdef WITH_PYTHON
 	RTLIL::Module::get_all_modules()->erase(hashidx_);
 #endif
@@ -971,7 +1254,7 @@ void RTLIL::Module::makeblackbox()
 	memories.clear();
 
 	for (auto it = cells_.begin(); it != cells_.end(); ++it)
-		delete it->second;
+		destroy(it->second);
 	cells_.clear();
 
 	for (auto it = processes.begin(); it != processes.end(); ++it)
@@ -979,6 +1262,7 @@ void RTLIL::Module::makeblackbox()
 	processes.clear();
 
 	connections_.clear();
+	invalidate_sigmap();
 
 	remove(delwires);
 	set_bool_attribute(ID::blackbox);
@@ -1877,6 +2161,16 @@ namespace {
 				check_expected();
 				return;
 			}
+			if (cell->type == ID($coverage_map)) {
+				param(ID::ABITS);
+				param(ID::WIDTH);
+				param_bool(ID::CLK_POLARITY);
+				port(ID::CLK, 1);
+				port(ID::ADDR, param(ID::ABITS) * param(ID(PORTS)));
+				port(ID(COUNT), param(ID::WIDTH));
+				check_expected();
+				return;
+			}
 			if (cell->type.in(ID($amt))) {
 				return;
 			}
@@ -2182,7 +2476,7 @@ void RTLIL::Module::remove(const pool<RTLIL::Wire*> &wires)
 	for (auto &it : wires) {
 		log_assert(wires_.count(it->name) != 0);
 		wires_.erase(it->name);
-		delete it;
+		destroy(it);
 	}
 }
 
@@ -2194,7 +2488,43 @@ void RTLIL::Module::remove(RTLIL::Cell *cell)
 	log_assert(cells_.count(cell->name) != 0);
 	log_assert(refcount_cells_ == 0);
 	cells_.erase(cell->name);
-	delete cell;
+	destroy(cell);
+}
+
+void RTLIL::Module::destroy(RTLIL::Wire *wire)
+{
+	if (wire_arena_) {
+		wire->~Wire();
+		wire_arena_->deallocate(wire);
+	} else
+		delete wire;
+}
+
+void RTLIL::Module::destroy(RTLIL::Cell *cell)
+{
+	if (cell_arena_) {
+		cell->~Cell();
+		cell_arena_->deallocate(cell);
+	} else
+		delete cell;
+}
+
+void RTLIL::Module::compact_arena()
+{
+	if (wire_arena_) {
+		std::vector<RTLIL::Wire*> wires;
+		wires.reserve(wires_.size());
+		for (auto &it : wires_)
+			wires.push_back(it.second);
+		wire_arena_->compact(wires.begin(), wires.end());
+	}
+	if (cell_arena_) {
+		std::vector<RTLIL::Cell*> cells;
+		cells.reserve(cells_.size());
+		for (auto &it : cells_)
+			cells.push_back(it.second);
+		cell_arena_->compact(cells.begin(), cells.end());
+	}
 }
 
 void RTLIL::Module::remove(RTLIL::Process *process)
@@ -2378,7 +2708,7 @@ void RTLIL::Module::fixup_ports()
 
 RTLIL::Wire *RTLIL::Module::addWire(RTLIL::IdString name, int width)
 {
-	RTLIL::Wire *wire = new RTLIL::Wire;
+	RTLIL::Wire *wire = wire_arena_ ? new (wire_arena_->allocate()) RTLIL::Wire : new RTLIL::Wire;
 	wire->name = name;
 	wire->width = width;
 	add(wire);
@@ -2401,7 +2731,7 @@ RTLIL::Wire *RTLIL::Module::addWire(RTLIL::IdString name, const RTLIL::Wire *oth
 
 RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, RTLIL::IdString type)
 {
-	RTLIL::Cell *cell = new RTLIL::Cell;
+	RTLIL::Cell *cell = cell_arena_ ? new (cell_arena_->allocate()) RTLIL::Cell : new RTLIL::Cell;
 	cell->name = name;
 	cell->type = type;
 	add(cell);
@@ -3388,8 +3718,7 @@ RTLIL::SigSpec RTLIL::Module::FutureFF(RTLIL::IdString name, const RTLIL::SigSpe
 RTLIL::Wire::Wire()
 {
 	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	hashidx_ = next_hashidx(hashidx_count);
 
 	module = nullptr;
 	width = 1;
@@ -3423,8 +3752,7 @@ std::map<unsigned int, RTLIL::Wire*> *RTLIL::Wire::get_all_wires(void)
 RTLIL::Memory::Memory()
 {
 	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	hashidx_ = next_hashidx(hashidx_count);
 
 	width = 1;
 	start_offset = 0;
@@ -3437,15 +3765,13 @@ RTLIL::Memory::Memory()
 RTLIL::Process::Process() : module(nullptr)
 {
 	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	hashidx_ = next_hashidx(hashidx_count);
 }
 
 RTLIL::Cell::Cell() : module(nullptr)
 {
 	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	hashidx_ = next_hashidx(hashidx_count);
 
 	// log("#memtrace# %p\n", this);
 	memhasher();
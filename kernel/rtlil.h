@@ -24,6 +24,9 @@
 
 YOSYS_NAMESPACE_BEGIN
 
+struct SlabArena;
+struct SigMap;
+
 namespace RTLIL
 {
 	enum State : unsigned char {
@@ -103,6 +106,21 @@ namespace RTLIL
 		static int last_created_idx_[8];
 	#endif
 
+		// Parallel regions: between begin_parallel() and end_parallel() IdStrings may be created,
+		// copied and destroyed by any number of threads. References are counted per thread,
+		// so all IdStrings are immortal for the duration of the region, and existing strings
+		// are looked up without locking in the global index, which is read-only. New strings
+		// go to sharded, locked tables and to storage segments that never move, so c_str()
+		// of another thread never sees its string move. end_parallel() merges the shards and
+		// segments, applies the counts of all threads and frees the strings without references.
+
+		static bool parallel_;
+		static int get_reference_parallel(const char *p);
+		static void count_reference_parallel(int idx, int delta);
+		static const char *c_str_parallel(int idx);
+		static void begin_parallel();
+		static void end_parallel();
+
 		static inline void xtrace_db_dump()
 		{
 		#ifdef YOSYS_XTRACE_GET_PUT
@@ -135,7 +153,10 @@ namespace RTLIL
 		{
 			if (idx) {
 		#ifndef YOSYS_NO_IDS_REFCNT
-				global_refcount_storage_[idx]++;
+				if (!parallel_)
+					global_refcount_storage_[idx]++;
+				else
+					count_reference_parallel(idx, 1);
 		#endif
 		#ifdef YOSYS_XTRACE_GET_PUT
 				if (yosys_xtrace)
@@ -149,6 +170,9 @@ namespace RTLIL
 		{
 			log_assert(destruct_guard_ok);
 
+			if (parallel_)
+				return get_reference_parallel(p);
+
 			if (!p[0])
 				return 0;
 
@@ -228,6 +252,11 @@ namespace RTLIL
 			if (!destruct_guard_ok || !idx)
 				return;
 
+			if (parallel_) {
+				count_reference_parallel(idx, -1);
+				return;
+			}
+
 		#ifdef YOSYS_XTRACE_GET_PUT
 			if (yosys_xtrace) {
 				log("#X# PUT '%s' (index %d, refcount %d)\n", global_id_storage_.at(idx), idx, global_refcount_storage_.at(idx));
@@ -285,11 +314,13 @@ namespace RTLIL
 		}
 
 		inline const char *c_str() const {
-			return global_id_storage_.at(index_);
+			if (index_ < GetSize(global_id_storage_))
+				return global_id_storage_[index_];
+			return c_str_parallel(index_);
 		}
 
 		inline std::string str() const {
-			return std::string(global_id_storage_.at(index_));
+			return std::string(c_str());
 		}
 
 		inline bool operator<(const IdString &rhs) const {
@@ -1166,6 +1197,10 @@ protected:
 	void add(RTLIL::Cell *cell);
 	void add(RTLIL::Process *process);
 
+	// destroys a wire or cell and returns its memory to the arena or the heap
+	void destroy(RTLIL::Wire *wire);
+	void destroy(RTLIL::Cell *cell);
+
 public:
 	RTLIL::Design *design;
 	pool<RTLIL::Monitor*> monitors;
@@ -1173,6 +1208,22 @@ public:
 	int refcount_wires_;
 	int refcount_cells_;
 
+	// wires and cells are allocated from per-module slabs if use_arena was set
+	// when the module was created, nullptr otherwise
+	static bool use_arena;
+	SlabArena *wire_arena_;
+	SlabArena *cell_arena_;
+	void compact_arena();
+
+	// SigMap of the connections, built on first use and then kept up to date by a monitor,
+	// so that passes can borrow it instead of building their own. Passes that add more
+	// relations or need a snapshot while connecting signals take a copy.
+	SigMap *sigmap_;
+	RTLIL::Monitor *sigmap_monitor_;
+	bool sigmap_valid_;
+	const SigMap &sigmap();
+	void invalidate_sigmap();
+
 	dict<RTLIL::IdString, RTLIL::Wire*> wires_;
 	dict<RTLIL::IdString, RTLIL::Cell*> cells_;
 
@@ -1722,6 +1773,7 @@ inline RTLIL::SigBit::SigBit(const RTLIL::SigSpec &sig) {
 template<typename T>
 void RTLIL::Module::rewrite_sigspecs(T &functor)
 {
+	invalidate_sigmap();
 	for (auto &it : cells_)
 		it.second->rewrite_sigspecs(functor);
 	for (auto &it : processes)
@@ -1735,6 +1787,7 @@ void RTLIL::Module::rewrite_sigspecs(T &functor)
 template<typename T>
 void RTLIL::Module::rewrite_sigspecs2(T &functor)
 {
+	invalidate_sigmap();
 	for (auto &it : cells_)
 		it.second->rewrite_sigspecs2(functor);
 	for (auto &it : processes)
@@ -26,6 +26,9 @@
 #include "kernel/macc.h"
 
 #include "libs/ezsat/ezminisat.h"
+#ifdef YOSYS_ENABLE_THREADS
+#  include "libs/ezsat/ezportfolio.h"
+#endif
 
 YOSYS_NAMESPACE_BEGIN
 
@@ -33,6 +36,17 @@ YOSYS_NAMESPACE_BEGIN
 extern struct SatSolver *yosys_satsolver_list;
 extern struct SatSolver *yosys_satsolver;
 
+// Portfolio mode for the solvers that support it, set with the satsolver command
+struct SatPortfolio
+{
+	// Number of diversified solver instances that race on every call, 1 disables the portfolio
+	int num_solvers = 1;
+	// Learnt clauses up to this size are shared between the instances, 0 disables sharing
+	int share_size = 0;
+};
+
+extern SatPortfolio yosys_sat_portfolio;
+
 struct SatSolver
 {
 	string name;
@@ -575,6 +575,16 @@ void yosys_shutdown()
 #endif
 }
 
+// NEW_ID may be used by the threads of a parallel IdString region, see RTLIL::IdString::begin_parallel()
+static int next_autoidx()
+{
+#if defined(YOSYS_ENABLE_THREADS) && (defined(__GNUC__) || defined(__clang__))
+	return __atomic_fetch_add(&autoidx, 1, __ATOMIC_RELAXED);
+#else
+	return autoidx++;
+#endif
+}
+
 RTLIL::IdString new_id(std::string file, int line, std::string func)
 {
 #ifdef _WIN32
@@ -589,7 +599,7 @@ RTLIL::IdString new_id(std::string file, int line, std::string func)
 	if (pos != std::string::npos)
 		func = func.substr(pos+1);
 
-	return stringf("$auto$%s:%d:%s$%d", file.c_str(), line, func.c_str(), autoidx++);
+	return stringf("$auto$%s:%d:%s$%d", file.c_str(), line, func.c_str(), next_autoidx());
 }
 
 RTLIL::IdString new_id_suffix(std::string file, int line, std::string func, std::string suffix)
@@ -606,7 +616,7 @@ RTLIL::IdString new_id_suffix(std::string file, int line, std::string func, std:
 	if (pos != std::string::npos)
 		func = func.substr(pos+1);
 
-	return stringf("$auto$%s:%d:%s$%s$%d", file.c_str(), line, func.c_str(), suffix.c_str(), autoidx++);
+	return stringf("$auto$%s:%d:%s$%s$%d", file.c_str(), line, func.c_str(), suffix.c_str(), next_autoidx());
 }
 
 RTLIL::Design *yosys_get_design()
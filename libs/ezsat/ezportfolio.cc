@@ -0,0 +1,314 @@
+/*
+ *  ezSAT -- A simple and easy to use CNF generator for SAT solvers
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// needed for MiniSAT headers (see Minisat Makefile)
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+
+#include "ezportfolio.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <cinttypes>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../minisat/Solver.h"
+#include "../minisat/SimpSolver.h"
+
+class ezPortfolioSolver : public Minisat::SimpSolver
+{
+public:
+	// Every instance but the first differs in its seed, restart policy and phase heuristics
+	ezPortfolioSolver(int index)
+	{
+		verbosity = 0;
+		if (index == 0)
+			return;
+		random_seed = 91648253 + 7919 * index;
+		rnd_init_act = index % 2 == 1;
+		luby_restart = index % 3 != 2;
+		restart_first = 100 * (1 + index % 4);
+		phase_saving = index % 5 == 4 ? 1 : 2;
+		rnd_pol = index % 4 == 3;
+		random_var_freq = 0.01 * (index % 3);
+	}
+
+	// Variable elimination as done by solve(), but separately so that it is never
+	// interrupted and all instances eliminate the same variables
+	bool simplifyWith(const Minisat::vec<Minisat::Lit> &assumps)
+	{
+		std::vector<Minisat::Var> extraFrozen;
+		for (int i = 0; i < assumps.size(); i++) {
+			Minisat::Var v = Minisat::var(assumps[i]);
+			if (!frozen[v]) {
+				setFrozen(v, true);
+				extraFrozen.push_back(v);
+			}
+		}
+		bool result = eliminate(false);
+		for (auto v : extraFrozen)
+			setFrozen(v, false);
+		return result;
+	}
+
+	void exportLearnts(int maxSize, std::vector<std::vector<int>> &clauses)
+	{
+		for (int i = 0; i < learnts.size(); i++) {
+			Minisat::Clause &c = ca[learnts[i]];
+			if (c.size() > maxSize)
+				continue;
+			std::vector<int> clause;
+			for (int j = 0; j < c.size(); j++)
+				clause.push_back(Minisat::toInt(c[j]));
+			std::sort(clause.begin(), clause.end());
+			clauses.push_back(clause);
+		}
+	}
+};
+
+ezPortfolioSAT::ezPortfolioSAT(int numSolvers, int shareSize) : numSolvers(std::max(numSolvers, 1)), shareSize(shareSize)
+{
+	numVars = 0;
+	foundContradiction = false;
+
+	freeze(CONST_TRUE);
+	freeze(CONST_FALSE);
+}
+
+ezPortfolioSAT::~ezPortfolioSAT()
+{
+	for (auto s : solvers)
+		delete s;
+}
+
+void ezPortfolioSAT::clear()
+{
+	for (auto s : solvers)
+		delete s;
+	solvers.clear();
+	numVars = 0;
+	foundContradiction = false;
+	cnfFrozenVars.clear();
+	sharedClauses.clear();
+	ezSAT::clear();
+}
+
+void ezPortfolioSAT::freeze(int id)
+{
+	if (!mode_non_incremental())
+		cnfFrozenVars.insert(bind(id));
+}
+
+bool ezPortfolioSAT::eliminated(int idx)
+{
+	idx = idx < 0 ? -idx : idx;
+	if (idx > 0 && idx <= numVars)
+		for (auto s : solvers)
+			if (s->isEliminated(idx-1))
+				return true;
+	return false;
+}
+
+void ezPortfolioSAT::shareClauses()
+{
+	std::vector<std::vector<int>> clauses;
+	for (auto s : solvers)
+		s->exportLearnts(shareSize, clauses);
+
+	for (auto &clause : clauses) {
+		if (!sharedClauses.insert(clause).second)
+			continue;
+		for (auto s : solvers) {
+			Minisat::vec<Minisat::Lit> ps;
+			for (auto lit : clause) {
+				if (s->isEliminated(Minisat::var(Minisat::toLit(lit))))
+					goto next_solver;
+				ps.push(Minisat::toLit(lit));
+			}
+			if (!s->addClause(ps))
+				foundContradiction = true;
+		next_solver:;
+		}
+	}
+}
+
+bool ezPortfolioSAT::solver(const std::vector<int> &modelExpressions, std::vector<bool> &modelValues, const std::vector<int> &assumptions)
+{
+	using namespace Minisat;
+
+	preSolverCallback();
+
+	solverTimoutStatus = false;
+
+	if (0) {
+contradiction:
+		for (auto s : solvers)
+			delete s;
+		solvers.clear();
+		numVars = 0;
+		foundContradiction = true;
+		return false;
+	}
+
+	if (foundContradiction) {
+		consumeCnf();
+		return false;
+	}
+
+	std::vector<int> extraClauses, modelIdx;
+
+	for (auto id : assumptions)
+		extraClauses.push_back(bind(id));
+	for (auto id : modelExpressions)
+		modelIdx.push_back(bind(id));
+
+	while (int(solvers.size()) < numSolvers)
+		solvers.push_back(new ezPortfolioSolver(solvers.size()));
+
+	std::vector<std::vector<int>> cnf;
+	consumeCnf(cnf);
+
+	// All instances create the same variables in the same order
+	while (numVars < numCnfVariables()) {
+		for (auto s : solvers)
+			s->newVar();
+		numVars++;
+	}
+
+	for (auto s : solvers)
+		for (auto idx : cnfFrozenVars)
+			s->setFrozen(idx > 0 ? idx-1 : -idx-1, true);
+	cnfFrozenVars.clear();
+
+	for (auto &clause : cnf) {
+		Minisat::vec<Minisat::Lit> ps;
+		for (auto idx : clause) {
+			if (idx > 0)
+				ps.push(Minisat::mkLit(idx-1));
+			else
+				ps.push(Minisat::mkLit(-idx-1, true));
+			if (eliminated(idx)) {
+				fprintf(stderr, "Assert in %s:%d failed! Missing call to ezsat->freeze(): %s (lit=%d)\n",
+						__FILE__, __LINE__, cnfLiteralInfo(idx).c_str(), idx);
+				abort();
+			}
+		}
+		for (auto s : solvers)
+			if (!s->addClause(ps))
+				goto contradiction;
+	}
+
+	if (cnf.size() > 0)
+		for (auto s : solvers)
+			if (!s->simplify())
+				goto contradiction;
+
+	Minisat::vec<Minisat::Lit> assumps;
+
+	for (auto idx : extraClauses) {
+		if (idx > 0)
+			assumps.push(Minisat::mkLit(idx-1));
+		else
+			assumps.push(Minisat::mkLit(-idx-1, true));
+		if (eliminated(idx)) {
+			fprintf(stderr, "Assert in %s:%d failed! Missing call to ezsat->freeze(): %s\n", __FILE__, __LINE__, cnfLiteralInfo(idx).c_str());
+			abort();
+		}
+	}
+
+	std::vector<std::thread> threads;
+
+	// Variable elimination first, on all instances alike
+	std::vector<char> simplified(solvers.size());
+	for (size_t i = 0; i < solvers.size(); i++)
+		threads.push_back(std::thread([&, i]() { simplified[i] = solvers[i]->simplifyWith(assumps); }));
+	for (auto &t : threads)
+		t.join();
+	threads.clear();
+	for (auto ok : simplified)
+		if (!ok)
+			goto contradiction;
+
+	std::mutex mutex;
+	std::condition_variable done;
+	std::vector<lbool> results(solvers.size(), l_Undef);
+	int winner = -1, finished = 0;
+
+	for (size_t i = 0; i < solvers.size(); i++)
+		threads.push_back(std::thread([&, i]() {
+			lbool result = solvers[i]->solveLimited(assumps, false);
+			std::lock_guard<std::mutex> lock(mutex);
+			results[i] = result;
+			if (winner < 0 && result != l_Undef)
+				winner = i;
+			finished++;
+			done.notify_all();
+		}));
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		auto answered = [&]() { return winner >= 0 || finished == int(solvers.size()); };
+		if (solverTimeout > 0) {
+			if (!done.wait_for(lock, std::chrono::seconds(solverTimeout), answered))
+				solverTimoutStatus = true;
+		} else
+			done.wait(lock, answered);
+	}
+
+	for (auto s : solvers)
+		s->interrupt();
+	for (auto &t : threads)
+		t.join();
+	for (auto s : solvers)
+		s->clearInterrupt();
+
+	if (shareSize > 0) {
+		shareClauses();
+		if (foundContradiction)
+			goto contradiction;
+	}
+
+	if (winner < 0 || results[winner] != l_True)
+		return false;
+
+	modelValues.clear();
+	modelValues.resize(modelIdx.size());
+
+	for (size_t i = 0; i < modelIdx.size(); i++)
+	{
+		int idx = modelIdx[i];
+		bool refvalue = true;
+
+		if (idx < 0)
+			idx = -idx, refvalue = false;
+
+		lbool value = solvers[winner]->modelValue(idx-1);
+		modelValues[i] = (value == lbool(refvalue));
+	}
+
+	return true;
+}
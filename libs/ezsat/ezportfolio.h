@@ -0,0 +1,54 @@
+/*
+ *  ezSAT -- A simple and easy to use CNF generator for SAT solvers
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef EZPORTFOLIO_H
+#define EZPORTFOLIO_H
+
+#include "ezsat.h"
+#include <set>
+
+class ezPortfolioSolver;
+
+// A portfolio of diversified MiniSat instances that all receive the same CNF. Every call
+// runs all instances on separate threads and the first answer wins, the other instances
+// are interrupted. Learnt clauses of at most shareSize literals are copied between the
+// instances after every call, they are implied by the CNF and stay valid for all later
+// calls of the incremental solver.
+class ezPortfolioSAT : public ezSAT
+{
+private:
+	std::vector<ezPortfolioSolver*> solvers;
+	int numSolvers, shareSize;
+	int numVars;
+	bool foundContradiction;
+	std::set<int> cnfFrozenVars;
+	std::set<std::vector<int>> sharedClauses;
+
+	void shareClauses();
+
+public:
+	ezPortfolioSAT(int numSolvers, int shareSize = 0);
+	virtual ~ezPortfolioSAT();
+	virtual void clear();
+	virtual void freeze(int id);
+	virtual bool eliminated(int idx);
+	virtual bool solver(const std::vector<int> &modelExpressions, std::vector<bool> &modelValues, const std::vector<int> &assumptions);
+};
+
+#endif
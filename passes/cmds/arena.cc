@@ -0,0 +1,109 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/arena.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct ArenaPass : public Pass {
+	ArenaPass() : Pass("arena", "allocate cells and wires of new modules from slabs") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    arena [on|off]\n");
+		log("\n");
+		log("Modules that are created while this is on allocate their cells and wires from\n");
+		log("large per-module slabs instead of one heap allocation per object. This saves\n");
+		log("the allocator overhead of every object and keeps the objects of a module close\n");
+		log("together, which speeds up iterating over large flat designs. Deleting such a\n");
+		log("module releases its slabs at once, and opt_clean releases the slabs that are\n");
+		log("left empty after removing unused cells and wires. The setting only affects\n");
+		log("modules created afterwards, so it is usually the first command of a script.\n");
+		log("The default is off. Without arguments it prints the current setting.\n");
+		log("\n");
+		log("\n");
+		log("    arena -stat [selection]\n");
+		log("\n");
+		log("Print the number of objects and slabs of the arenas of the selected modules.\n");
+		log("\n");
+		log("\n");
+		log("    arena -compact [selection]\n");
+		log("\n");
+		log("Release the empty slabs of the selected modules now.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		bool stat_mode = false;
+		bool compact_mode = false;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-stat") {
+				stat_mode = true;
+				continue;
+			}
+			if (args[argidx] == "-compact") {
+				compact_mode = true;
+				continue;
+			}
+			break;
+		}
+
+		if (!stat_mode && !compact_mode) {
+			if (argidx+1 < args.size())
+				cmd_error(args, argidx+1, "Extra argument.");
+			if (argidx < args.size()) {
+				if (args[argidx] != "on" && args[argidx] != "off")
+					cmd_error(args, argidx, "Expected `on' or `off'.");
+				RTLIL::Module::use_arena = args[argidx] == "on";
+			}
+			log("Allocating cells and wires of new modules from %s.\n", RTLIL::Module::use_arena ? "arenas" : "the heap");
+			return;
+		}
+
+		extra_args(args, argidx, design);
+
+		for (auto module : design->selected_whole_modules_warn()) {
+			if (!module->wire_arena_) {
+				if (stat_mode)
+					log("Module %s allocates from the heap.\n", log_id(module));
+				continue;
+			}
+			int released_wire_slabs = 0, released_cell_slabs = 0;
+			if (compact_mode) {
+				int wire_slabs = module->wire_arena_->num_slabs();
+				int cell_slabs = module->cell_arena_->num_slabs();
+				module->compact_arena();
+				released_wire_slabs = wire_slabs - module->wire_arena_->num_slabs();
+				released_cell_slabs = cell_slabs - module->cell_arena_->num_slabs();
+			}
+			if (stat_mode || released_wire_slabs || released_cell_slabs)
+				log("Module %s: %d wires in %d slabs (%.1f KiB), %d cells in %d slabs (%.1f KiB)%s.\n", log_id(module),
+						module->wire_arena_->num_live(), module->wire_arena_->num_slabs(), module->wire_arena_->capacity_bytes() / 1024.0,
+						module->cell_arena_->num_live(), module->cell_arena_->num_slabs(), module->cell_arena_->capacity_bytes() / 1024.0,
+						compact_mode ? stringf(", released %d and %d slabs", released_wire_slabs, released_cell_slabs).c_str() : "");
+		}
+	}
+} ArenaPass;
+
+PRIVATE_NAMESPACE_END
@@ -0,0 +1,75 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#ifdef YOSYS_ENABLE_THREADS
+#  include <thread>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct ThreadsPass : public Pass {
+	ThreadsPass() : Pass("threads", "set the number of threads of module-parallel passes") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    threads [<num>]\n");
+		log("\n");
+		log("This command sets the number of worker threads that opt_expr, opt_merge,\n");
+		log("opt_muxtree, opt_reduce, opt_dff, opt_clean and clean use to process the\n");
+		log("selected modules concurrently. 0 uses one thread per core. The default is 1,\n");
+		log("which processes the modules one after the other. Without arguments it prints\n");
+		log("the current setting.\n");
+		log("\n");
+		log("The modules are processed bottom-up in the hierarchy: a module is started only\n");
+		log("after all the modules it instantiates are done. The log output of every module\n");
+		log("is buffered and written in the usual module order. The autogenerated names\n");
+		log("of new cells and wires depend on the timing of the threads though.\n");
+		log("\n");
+		log("Only available if Yosys was built with ENABLE_THREADS.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) override
+	{
+		if (args.size() > 2)
+			cmd_error(args, 2, "Extra argument.");
+
+		if (args.size() == 2) {
+			int num_threads = atoi(args[1].c_str());
+			if (num_threads < 0)
+				log_cmd_error("Invalid number of threads `%s'.\n", args[1].c_str());
+#ifdef YOSYS_ENABLE_THREADS
+			if (num_threads == 0)
+				num_threads = max(1u, std::thread::hardware_concurrency());
+#else
+			if (num_threads != 1)
+				log_cmd_error("This version of Yosys was built without thread support.\n");
+#endif
+			ParallelModulePass::num_threads = num_threads;
+		}
+
+		log("Module-parallel passes use %d thread%s.\n", ParallelModulePass::num_threads,
+				ParallelModulePass::num_threads == 1 ? "" : "s");
+	}
+} ThreadsPass;
+
+PRIVATE_NAMESPACE_END
@@ -0,0 +1,359 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "passes/inject/rng.h"
+#include <algorithm>
+
+YOSYS_NAMESPACE_BEGIN
+
+#define STATE_WIDTH 20
+#define SUM_WIDTH 30
+
+static bool is_flipflop(RTLIL::Cell *cell){
+    return cell->type == ID($dff) || cell->type == ID($dffe) || cell->type == ID($dffsr) || cell->type == ID($dffsre) || cell->type == ID($adff) || cell->type == ID($sdff) || cell->type == ID($sdffe) || cell->type == ID($sdffce) || cell->type == ID($adffe) || cell->type == ID($aldff) || cell->type == ID($aldffe);
+}
+
+// Finds the flip-flops in the fan-in cones of signals, the search stops at flip-flops. The cone of
+// every cell is computed once with an explicit stack and shared by all signals that reach it.
+struct ControlRegisterFinder {
+    SigMap sigmap;
+    dict<RTLIL::SigBit, RTLIL::Cell *> drivers;
+    std::vector<RTLIL::Cell *> flipflops;
+    // Sorted indices into flipflops
+    dict<RTLIL::Cell *, std::vector<int>> cones;
+
+    ControlRegisterFinder(RTLIL::Module *module) : sigmap(module->sigmap()) {
+        for (auto cell : module->cells()) {
+            if (is_flipflop(cell)) {
+                cones[cell] = std::vector<int>(1, GetSize(flipflops));
+                flipflops.push_back(cell);
+            }
+            for (auto &connection : cell->connections())
+                if (cell->output(connection.first))
+                    for (auto bit : sigmap(connection.second))
+                        if (bit.wire && !drivers.count(bit))
+                            drivers[bit] = cell;
+        }
+    }
+
+    std::vector<RTLIL::Cell *> input_drivers(RTLIL::Cell *cell) {
+        std::vector<RTLIL::Cell *> result;
+        for (auto &connection : cell->connections()) {
+            if (!cell->input(connection.first)) continue;
+            for (auto bit : sigmap(connection.second)) {
+                auto it = drivers.find(bit);
+                if (it != drivers.end())
+                    result.push_back(it->second);
+            }
+        }
+        return result;
+    }
+
+    // Post-order traversal of the cone of root. A cell of a combinational loop does not see the
+    // flip-flops that are only reachable through the cell that closed the loop.
+    void compute(RTLIL::Cell *root) {
+        std::vector<std::pair<RTLIL::Cell *, bool>> stack = {{root, false}};
+        pool<RTLIL::Cell *> active;
+        while (!stack.empty()) {
+            RTLIL::Cell *cell = stack.back().first;
+            if (cones.count(cell)) {
+                stack.pop_back();
+                continue;
+            }
+            if (!stack.back().second) {
+                stack.back().second = true;
+                active.insert(cell);
+                for (auto driver : input_drivers(cell))
+                    if (!cones.count(driver) && !active.count(driver))
+                        stack.push_back({driver, false});
+                continue;
+            }
+            std::vector<int> cone;
+            for (auto driver : input_drivers(cell)) {
+                auto it = cones.find(driver);
+                if (it != cones.end())
+                    cone.insert(cone.end(), it->second.begin(), it->second.end());
+            }
+            std::sort(cone.begin(), cone.end());
+            cone.erase(std::unique(cone.begin(), cone.end()), cone.end());
+            cones[cell] = std::move(cone);
+            active.erase(cell);
+            stack.pop_back();
+        }
+    }
+
+    std::vector<int> cone(RTLIL::SigSpec sig) {
+        std::vector<int> result;
+        for (auto bit : sigmap(sig)) {
+            auto it = drivers.find(bit);
+            if (it == drivers.end()) continue;
+            compute(it->second);
+            const std::vector<int> &driver_cone = cones.at(it->second);
+            result.insert(result.end(), driver_cone.begin(), driver_cone.end());
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+};
+
+// Control registers are the flip-flops that drive mux selects. Registers that are too wide to be
+// control state, e.g. data compared against a constant, are replaced by the select itself.
+static void find_control_registers(RTLIL::Module *module, std::set<RTLIL::SigSpec> &control_signals) {
+    ControlRegisterFinder finder(module);
+    dict<RTLIL::SigSpec, std::vector<int>> select_cones;
+
+    for (auto cell : module->selected_cells()) {
+        if (cell->type == ID($mux) || cell->type == ID($pmux)){
+            RTLIL::SigSpec select = cell->getPort(ID::S);
+            RTLIL::SigSpec key = finder.sigmap(select);
+            if (!select_cones.count(key))
+                select_cones[key] = finder.cone(select);
+            for (int i : select_cones.at(key)) {
+                RTLIL::SigSpec output = finder.flipflops.at(i)->getPort(ID::Q);
+                if (output.size() < STATE_WIDTH) {
+                    control_signals.insert(output);
+                } else {
+                    control_signals.insert(select);
+                }
+            }
+        }
+    }
+}
+
+static RTLIL::SigSpec pad(CounterRng &rng, RTLIL::SigSpec signal){
+    RTLIL::SigSpec padded;
+
+    int shift = rng(STATE_WIDTH - signal.size() + 1);
+    padded.append(RTLIL::Const(0, shift));
+    padded.append(signal);
+    padded.append(RTLIL::Const(0, STATE_WIDTH - padded.size()));
+
+    return padded;
+}
+
+static RTLIL::SigSpec xor_control_registers(RTLIL::Module *module, std::set<RTLIL::SigSpec> control_signals, uint64_t seed) {
+    // The shifts of a module only depend on the seed and the module name
+    CounterRng rng(seed, module->name.str());
+    RTLIL::SigSpec result(pad(rng, RTLIL::Const(0, 1)));
+
+    for (auto control_signal : control_signals) {
+        RTLIL::Wire *temp = module->addWire(NEW_ID, STATE_WIDTH);
+        module->addXor(NEW_ID, result, pad(rng, control_signal), temp);
+        result = RTLIL::SigSpec(temp);
+    }
+    return result;
+}
+
+static bool find_clock(RTLIL::Module *module, RTLIL::SigSpec &clock){
+    for (auto cell : module->selected_cells()){
+        if (is_flipflop(cell)) {
+            clock = cell->getPort(ID::CLK);
+            if (clock.is_wire()) return true;
+        }
+    }
+    return false;
+}
+
+// Sums single bits with a balanced tree of adders, so the counter update stays shallow for many bits
+inline RTLIL::SigSpec popcount(RTLIL::Module *module, std::vector<RTLIL::SigSpec> terms){
+    if (terms.empty())
+        return RTLIL::Const(0, 1);
+    while (GetSize(terms) > 1) {
+        std::vector<RTLIL::SigSpec> sums;
+        for (int i = 0; i + 1 < GetSize(terms); i += 2) {
+            RTLIL::SigSpec sum = module->addWire(NEW_ID, max(GetSize(terms[i]), GetSize(terms[i+1])) + 1);
+            module->addAdd(NEW_ID, terms[i], terms[i+1], sum);
+            sums.push_back(sum);
+        }
+        if (GetSize(terms) % 2)
+            sums.push_back(terms.back());
+        terms.swap(sums);
+    }
+    return terms.front();
+}
+
+// Adds a coverage map that records one abits wide state per port
+static void add_coverage_map(RTLIL::Module *module, RTLIL::IdString name, RTLIL::SigSpec clock, int abits, RTLIL::SigSpec states, RTLIL::SigSpec count){
+    RTLIL::Cell *cell = module->addCell(name, ID($coverage_map));
+    cell->setParam(ID::ABITS, abits);
+    cell->setParam(ID(PORTS), GetSize(states) / abits);
+    cell->setParam(ID::WIDTH, GetSize(count));
+    cell->setParam(ID::CLK_POLARITY, RTLIL::Const(1, 1));
+    cell->setPort(ID::CLK, clock);
+    cell->setPort(ID::ADDR, states);
+    cell->setPort(ID(COUNT), count);
+}
+
+static bool has_port(RTLIL::Module *module, std::string name){
+    return std::find(module->ports.begin(), module->ports.end(), RTLIL::escape_id(name)) != module->ports.end();
+}
+
+// A wrapper without flip-flops of its own uses the clock of a submodule, if it is an input port
+static bool find_instance_clock(RTLIL::Design *design, RTLIL::Module *module, RTLIL::SigSpec &clock){
+    if (find_clock(module, clock)) return true;
+    for (auto cell : module->selected_cells()){
+        RTLIL::Module *submodule = design->module(cell->type);
+        RTLIL::SigSpec submodule_clock;
+        if (!submodule || !find_instance_clock(design, submodule, submodule_clock)) continue;
+        RTLIL::Wire *wire = submodule_clock.as_wire();
+        if (wire->port_input && cell->hasPort(wire->name) && cell->getPort(wire->name).is_wire()) {
+            clock = cell->getPort(wire->name);
+            return true;
+        }
+    }
+    return false;
+}
+
+// With a global top, modules do not keep a map of their own but export their state and the states
+// of their submodules as io_covState, and the top module records all of them in one map. Modules
+// without a state of their own then still pass on the states of their submodules.
+static void difuzzrtl_coverage_module(RTLIL::Design *design, RTLIL::Module *module, uint64_t seed, RTLIL::Module *global_top){
+    if (module->has_attribute(ID(drtl_coverage))) return;
+
+    RTLIL::SigSpec clock;
+    std::set<RTLIL::SigSpec> control_registers;
+    if (find_clock(module, clock))
+        find_control_registers(module, control_registers);
+    if (!control_registers.size() && !global_top) return;
+
+    RTLIL::SigSpec states;
+    if (control_registers.size()) {
+        RTLIL::SigSpec xored_registers = xor_control_registers(module, control_registers, seed);
+        RTLIL::SigSpec state(module->addWire(module->name.str() + "_state", STATE_WIDTH));
+        module->addDff(NEW_ID, clock, xored_registers, state);
+        states = state;
+    }
+
+    RTLIL::SigSpec cov_sum, current_covsum;
+    if (!global_top) {
+        cov_sum = module->addWire(module->name.str() + "_covSum", SUM_WIDTH);
+        add_coverage_map(module, module->name.str() + "_coverage_map", clock, STATE_WIDTH, states, cov_sum);
+
+        RTLIL::Wire *io_covsum = module->addWire(RTLIL::escape_id("io_covSum"), SUM_WIDTH);
+        io_covsum->port_output = true;
+        module->fixup_ports();
+        current_covsum = RTLIL::SigSpec(io_covsum);
+    }
+
+    for (auto cell : module->selected_cells()){
+        if (cell->type.isPublic()) {
+            RTLIL::Module *submodule = design->module(cell->type);
+            if (!submodule) continue;
+            difuzzrtl_coverage_module(design, submodule, seed, global_top);
+
+            if (global_top) {
+                if (!has_port(submodule, "io_covState")) continue;
+                RTLIL::SigSpec cell_states = RTLIL::SigSpec(module->addWire(NEW_ID, submodule->wire(RTLIL::escape_id("io_covState"))->width));
+                cell->setPort(RTLIL::escape_id("io_covState"), cell_states);
+                states.append(cell_states);
+                continue;
+            }
+
+            if (!has_port(submodule, "io_covSum")) continue;
+            RTLIL::SigSpec new_covsum = RTLIL::SigSpec(module->addWire(NEW_ID, SUM_WIDTH));
+            RTLIL::SigSpec cell_covsum = RTLIL::SigSpec(module->addWire(NEW_ID, SUM_WIDTH));
+            cell->setPort(RTLIL::escape_id("io_covSum"), cell_covsum);
+            module->addAdd(NEW_ID, new_covsum, cell_covsum, current_covsum);
+            current_covsum = new_covsum;
+        }
+    }
+
+    if (!global_top) {
+        module->connect(current_covsum, cov_sum);
+    } else if (module != global_top) {
+        if (GetSize(states)) {
+            RTLIL::Wire *io_covstate = module->addWire(RTLIL::escape_id("io_covState"), GetSize(states));
+            io_covstate->port_output = true;
+            module->fixup_ports();
+            module->connect(io_covstate, states);
+        }
+    } else if (GetSize(states)) {
+        if (clock.empty() && !find_instance_clock(design, module, clock))
+            log_error("Can not find a clock for the coverage map of module %s!\n", log_id(module));
+
+        // The map holds PORTS << ABITS bits, the count has to hold all of them being set
+        int ports = GetSize(states) / STATE_WIDTH;
+        cov_sum = module->addWire(module->name.str() + "_covSum", ceil_log2(ports) + STATE_WIDTH + 1);
+        add_coverage_map(module, module->name.str() + "_coverage_map", clock, STATE_WIDTH, states, cov_sum);
+
+        RTLIL::Wire *io_covsum = module->addWire(RTLIL::escape_id("io_covSum"), GetSize(cov_sum));
+        io_covsum->port_output = true;
+        module->fixup_ports();
+        module->connect(io_covsum, cov_sum);
+    }
+
+    module->set_bool_attribute(ID(drtl_coverage));
+    log("Module: %s\n", module->name.c_str());
+}
+
+// Adds a metaReset input that clears every flip-flop, the difuzzrtl metric instruments it together
+// with the coverage. Note: This does not produce _halt signals
+inline void difuzzrtl_reset_module(RTLIL::Design *design, RTLIL::Module *module){
+    if (module->has_attribute(ID(drtl_reset))) return;
+
+    RTLIL::Wire *meta_reset = module->addWire(RTLIL::escape_id("metaReset"));
+    meta_reset->port_input = true;
+    module->fixup_ports();
+
+    for (auto cell : module->selected_cells()){
+        if (is_flipflop(cell)) {
+            RTLIL::SigSpec old_input = cell->getPort(ID::D);
+            cell->unsetPort(ID::D);
+            RTLIL::Wire *new_input = module->addWire(NEW_ID, old_input.size());
+            cell->setPort(ID::D, new_input);
+            module->addMux(NEW_ID, old_input, RTLIL::Const(0, old_input.size()), meta_reset, new_input);
+        } else if (cell->type.isPublic()) {
+            RTLIL::Module *submodule = design->module(cell->type);
+            difuzzrtl_reset_module(design, submodule);
+            cell->setPort(RTLIL::escape_id("metaReset"), meta_reset);
+        }
+    }
+
+    module->set_bool_attribute(ID(drtl_reset));
+    log("Module: %s\n", module->name.c_str());
+}
+
+inline void difuzzrtl_reset(RTLIL::Design *design){
+    for (auto module : design->selected_modules()) {
+        difuzzrtl_reset_module(design, module);
+    }
+}
+
+inline void difuzzrtl_coverage(RTLIL::Design *design, uint64_t seed, bool global){
+    if (global) {
+        RTLIL::Module *top = design->top_module();
+        if (!top)
+            log_cmd_error("No top module found, -global requires a design hierarchy!\n");
+        difuzzrtl_coverage_module(design, top, seed, top);
+        return;
+    }
+    for (auto module : design->selected_modules()) {
+        difuzzrtl_coverage_module(design, module, seed, nullptr);
+    }
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/log.h"
+#include "kernel/register.h"
+#include "kernel/mem.h"
+#include "coverage.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+#define WORD_BITS 6
+#define WORD_WIDTH (1 << WORD_BITS)
+
+static void map_coverage_map(RTLIL::Cell *cell, RTLIL::Module *module)
+{
+	log("Mapping coverage map %s from module %s.\n", cell->name.c_str(), module->name.c_str());
+
+	int abits = cell->getParam(ID::ABITS).as_int();
+	int ports = cell->getParam(ID(PORTS)).as_int();
+	bool clk_polarity = cell->getParam(ID::CLK_POLARITY).as_bool();
+	RTLIL::SigSpec clk = cell->getPort(ID::CLK);
+	RTLIL::SigSpec addr = cell->getPort(ID::ADDR);
+	RTLIL::SigSpec count = cell->getPort(ID(COUNT));
+
+	// The bitset of every port is a power of two bits, so the word address and the bit
+	// within the word are slices of the bit index {port, addr}
+	int index_width = max(abits + ceil_log2(ports), WORD_BITS + 1);
+	int words = ((int64_t(ports) << abits) + WORD_WIDTH - 1) / WORD_WIDTH;
+
+	Mem mem(module, cell->name, WORD_WIDTH, 0, words);
+	MemInit init;
+	init.addr = RTLIL::Const(0);
+	init.data = RTLIL::Const(RTLIL::State::S0, words * WORD_WIDTH);
+	init.en = RTLIL::Const(RTLIL::State::S1, WORD_WIDTH);
+	mem.inits.push_back(init);
+
+	std::vector<RTLIL::SigSpec> is_new;
+	for (int i = 0; i < ports; ++i) {
+		RTLIL::SigSpec index = addr.extract(i * abits, abits);
+		index.append(RTLIL::Const(i, index_width - abits));
+		RTLIL::SigSpec bit = index.extract(0, WORD_BITS);
+		RTLIL::SigSpec word_addr = index.extract(WORD_BITS, index_width - WORD_BITS);
+
+		RTLIL::SigSpec word = module->addWire(NEW_ID, WORD_WIDTH);
+		MemRd rd;
+		rd.addr = word_addr;
+		rd.data = word;
+		rd.init_value = RTLIL::Const(RTLIL::State::Sx, WORD_WIDTH);
+		rd.arst_value = RTLIL::Const(RTLIL::State::Sx, WORD_WIDTH);
+		rd.srst_value = RTLIL::Const(RTLIL::State::Sx, WORD_WIDTH);
+		mem.rd_ports.push_back(rd);
+
+		RTLIL::SigSpec hit = module->addWire(NEW_ID);
+		module->addShiftx(NEW_ID, word, bit, hit);
+		is_new.push_back(module->Not(NEW_ID, hit));
+
+		// Every port only sets its own bit, so the writes of different ports never conflict
+		MemWr wr;
+		wr.wide_log2 = 0;
+		wr.clk_enable = true;
+		wr.clk_polarity = clk_polarity;
+		wr.clk = clk;
+		wr.en = module->Shl(NEW_ID, RTLIL::Const(1, WORD_WIDTH), bit);
+		wr.addr = word_addr;
+		wr.data = RTLIL::Const(RTLIL::State::S1, WORD_WIDTH);
+		mem.wr_ports.push_back(wr);
+	}
+	for (auto &rd : mem.rd_ports) {
+		rd.transparency_mask = std::vector<bool>(ports, false);
+		rd.collision_x_mask = std::vector<bool>(ports, false);
+	}
+	for (auto &wr : mem.wr_ports)
+		wr.priority_mask = std::vector<bool>(ports, false);
+
+	// The counter is maintained incrementally and always equals the popcount of the bitset
+	RTLIL::Wire *counter = module->addWire(NEW_ID, GetSize(count));
+	counter->attributes[ID::init] = RTLIL::Const(0, GetSize(count));
+	RTLIL::SigSpec next = module->addWire(NEW_ID, GetSize(count));
+	module->addAdd(NEW_ID, counter, popcount(module, is_new), next);
+	module->addDff(NEW_ID, clk, next, counter, clk_polarity);
+	module->connect(count, counter);
+
+	module->remove(cell);
+	mem.emit();
+}
+
+struct DifuzzRTLMapPass : public Pass {
+	DifuzzRTLMapPass() : Pass("difuzzrtl_map", "map coverage maps to memories and logic") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    difuzzrtl_map [selection]\n");
+		log("\n");
+		log("This pass maps $coverage_map cells, as created by difuzzrtl_instrument, to a\n");
+		log("memory of 64-bit words that holds the bitset and a counter that is incremented\n");
+		log("by the number of newly set bits in every cycle. Run it before write_cxxrtl, sim\n");
+		log("or any other backend that does not know the cell. The memory is named after the\n");
+		log("cell, so with difuzzrtl_instrument -global the complete coverage of the design is\n");
+		log("one contiguous array of the CXXRTL model.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		log_header(design, "Executing DIFUZZRTL_MAP pass (mapping coverage maps to memories).\n");
+		extra_args(args, 1, design);
+
+		for (auto mod : design->selected_modules()) {
+			std::vector<RTLIL::Cell*> coverage_cells;
+			for (auto cell : mod->selected_cells())
+				if (cell->type == ID($coverage_map))
+					coverage_cells.push_back(cell);
+			for (auto cell : coverage_cells)
+				map_coverage_map(cell, mod);
+		}
+	}
+} DifuzzRTLMapPass;
+
+PRIVATE_NAMESPACE_END
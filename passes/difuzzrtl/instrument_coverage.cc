@@ -0,0 +1,321 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/log.h"
+#include "kernel/register.h"
+#include "coverage.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static const std::vector<std::string> metrics = {"difuzzrtl", "toggle", "mux", "fsm", "ctrlreg"};
+
+// Folds a signal into at most width bits by XORing its chunks
+static RTLIL::SigSpec fold(RTLIL::Module *module, RTLIL::SigSpec signal, int width){
+    RTLIL::SigSpec result = signal.extract(0, min(width, GetSize(signal)));
+    for (int offset = width; offset < GetSize(signal); offset += width) {
+        RTLIL::SigSpec chunk = signal.extract(offset, min(width, GetSize(signal) - offset));
+        chunk.append(RTLIL::Const(0, width - GetSize(chunk)));
+        result = module->Xor(NEW_ID, result, chunk);
+    }
+    return result;
+}
+
+// Keeps a sticky bit per coverage point and counts the points as they are hit for the first time
+static RTLIL::SigSpec count_points(RTLIL::Module *module, RTLIL::SigSpec clock, RTLIL::SigSpec events){
+    RTLIL::Wire *covered = module->addWire(module->name.str() + "_covered", GetSize(events));
+    covered->attributes[ID::init] = RTLIL::Const(0, GetSize(events));
+    RTLIL::SigSpec first = module->And(NEW_ID, events, module->Not(NEW_ID, covered));
+    module->addDff(NEW_ID, clock, module->Or(NEW_ID, covered, events), covered);
+
+    std::vector<RTLIL::SigSpec> terms;
+    for (auto bit : first)
+        terms.push_back(bit);
+
+    RTLIL::Wire *count = module->addWire(NEW_ID, SUM_WIDTH);
+    count->attributes[ID::init] = RTLIL::Const(0, SUM_WIDTH);
+    RTLIL::SigSpec next = module->addWire(NEW_ID, SUM_WIDTH);
+    module->addAdd(NEW_ID, count, popcount(module, terms), next);
+    module->addDff(NEW_ID, clock, next, count);
+    return count;
+}
+
+// Records the values of every signal in coverage maps, signals of the same width share a map
+static RTLIL::SigSpec map_values(RTLIL::Module *module, RTLIL::SigSpec clock, const std::vector<RTLIL::SigSpec> &signals){
+    std::map<int, RTLIL::SigSpec> states;
+    for (auto &signal : signals) {
+        RTLIL::SigSpec state = fold(module, signal, STATE_WIDTH);
+        states[GetSize(state)].append(state);
+    }
+
+    RTLIL::SigSpec sum;
+    for (auto &it : states) {
+        RTLIL::SigSpec count = module->addWire(NEW_ID, SUM_WIDTH);
+        add_coverage_map(module, stringf("%s_coverage_map_%d", module->name.c_str(), it.first), clock, it.first, it.second, count);
+        sum = sum.empty() ? count : module->Add(NEW_ID, sum, count);
+    }
+    return sum;
+}
+
+// Every flip-flop bit has a rising and a falling point
+static RTLIL::SigSpec toggle_coverage(RTLIL::Module *module, RTLIL::SigSpec clock){
+    RTLIL::SigSpec q;
+    for (auto cell : module->selected_cells())
+        if (is_flipflop(cell))
+            q.append(cell->getPort(ID::Q));
+    if (q.empty()) return RTLIL::SigSpec();
+
+    RTLIL::SigSpec previous = module->addWire(NEW_ID, GetSize(q));
+    module->addDff(NEW_ID, clock, q, previous);
+    RTLIL::SigSpec events;
+    events.append(module->And(NEW_ID, q, module->Not(NEW_ID, previous)));
+    events.append(module->And(NEW_ID, module->Not(NEW_ID, q), previous));
+    return count_points(module, clock, events);
+}
+
+// Every $mux has a point per select value, every $pmux a point per case and one for the default
+static RTLIL::SigSpec mux_coverage(RTLIL::Module *module, RTLIL::SigSpec clock){
+    RTLIL::SigSpec events;
+    for (auto cell : module->selected_cells()) {
+        if (cell->type == ID($mux)) {
+            RTLIL::SigSpec select = cell->getPort(ID::S);
+            events.append(select);
+            events.append(module->Not(NEW_ID, select));
+        } else if (cell->type == ID($pmux)) {
+            RTLIL::SigSpec select = cell->getPort(ID::S);
+            events.append(select);
+            events.append(module->LogicNot(NEW_ID, select));
+        }
+    }
+    if (events.empty()) return RTLIL::SigSpec();
+    return count_points(module, clock, events);
+}
+
+// Every transition of a state register found by fsm_detect is a point
+static RTLIL::SigSpec fsm_coverage(RTLIL::Module *module, RTLIL::SigSpec clock){
+    std::vector<RTLIL::SigSpec> transitions;
+    for (auto wire : module->selected_wires()) {
+        if (!wire->attributes.count(ID::fsm_encoding) || wire->attributes.at(ID::fsm_encoding).decode_string() == "none")
+            continue;
+        RTLIL::SigSpec previous = module->addWire(NEW_ID, wire->width);
+        module->addDff(NEW_ID, clock, wire, previous);
+        RTLIL::SigSpec transition = previous;
+        transition.append(wire);
+        transitions.push_back(transition);
+    }
+    if (transitions.empty()) return RTLIL::SigSpec();
+    return map_values(module, clock, transitions);
+}
+
+// Every value of every control register is a point
+static RTLIL::SigSpec ctrlreg_coverage(RTLIL::Module *module, RTLIL::SigSpec clock){
+    std::set<RTLIL::SigSpec> control_registers;
+    find_control_registers(module, control_registers);
+    if (control_registers.empty()) return RTLIL::SigSpec();
+    return map_values(module, clock, std::vector<RTLIL::SigSpec>(control_registers.begin(), control_registers.end()));
+}
+
+static void coverage_module(RTLIL::Design *design, RTLIL::Module *module, const std::string &metric, uint64_t seed){
+    if (metric == "difuzzrtl") {
+        difuzzrtl_coverage_module(design, module, seed, nullptr);
+        return;
+    }
+    if (module->has_attribute(ID(drtl_coverage))) return;
+
+    std::vector<RTLIL::SigSpec> counts;
+    RTLIL::SigSpec clock;
+    if (find_clock(module, clock)) {
+        RTLIL::SigSpec count;
+        if (metric == "toggle") count = toggle_coverage(module, clock);
+        if (metric == "mux") count = mux_coverage(module, clock);
+        if (metric == "fsm") count = fsm_coverage(module, clock);
+        if (metric == "ctrlreg") count = ctrlreg_coverage(module, clock);
+        if (!count.empty()) counts.push_back(count);
+    }
+
+    for (auto cell : module->selected_cells()){
+        RTLIL::Module *submodule = design->module(cell->type);
+        if (!cell->type.isPublic() || !submodule) continue;
+        coverage_module(design, submodule, metric, seed);
+        if (!has_port(submodule, "io_covSum")) continue;
+        RTLIL::SigSpec cell_covsum = RTLIL::SigSpec(module->addWire(NEW_ID, SUM_WIDTH));
+        cell->setPort(RTLIL::escape_id("io_covSum"), cell_covsum);
+        counts.push_back(cell_covsum);
+    }
+
+    module->set_bool_attribute(ID(drtl_coverage));
+    if (counts.empty()) return;
+
+    RTLIL::Wire *io_covsum = module->addWire(RTLIL::escape_id("io_covSum"), SUM_WIDTH);
+    io_covsum->port_output = true;
+    module->fixup_ports();
+
+    RTLIL::SigSpec sum = counts.front();
+    for (int i = 1; i < GetSize(counts); ++i) {
+        RTLIL::SigSpec next_sum = RTLIL::SigSpec(module->addWire(NEW_ID, SUM_WIDTH));
+        module->addAdd(NEW_ID, sum, counts.at(i), next_sum);
+        sum = next_sum;
+    }
+    module->connect(io_covsum, sum);
+    log("Module: %s\n", module->name.c_str());
+}
+
+struct coverage_cost_t {
+    int cells = 0;
+    int64_t state_bits = 0;
+};
+
+// Cells and state bits of all module definitions, a rough measure of the cost of simulating them
+static coverage_cost_t design_cost(RTLIL::Design *design){
+    coverage_cost_t cost;
+    for (auto module : design->modules()) {
+        cost.cells += GetSize(module->cells());
+        for (auto cell : module->cells()) {
+            if (is_flipflop(cell))
+                cost.state_bits += GetSize(cell->getPort(ID::Q));
+            else if (cell->type == ID($coverage_map))
+                cost.state_bits += (int64_t(cell->getParam(ID(PORTS)).as_int()) << cell->getParam(ID::ABITS).as_int()) + cell->getParam(ID::WIDTH).as_int();
+            else if (cell->type.in(ID($mem), ID($mem_v2)))
+                cost.state_bits += int64_t(cell->getParam(ID::WIDTH).as_int()) * cell->getParam(ID::SIZE).as_int();
+        }
+        for (auto &it : module->memories)
+            cost.state_bits += int64_t(it.second->width) * it.second->size;
+    }
+    return cost;
+}
+
+static coverage_cost_t instrument(RTLIL::Design *design, const std::string &metric, uint64_t seed){
+    coverage_cost_t before = design_cost(design);
+    if (metric == "fsm")
+        Pass::call(design, "fsm_detect");
+    if (metric == "difuzzrtl")
+        difuzzrtl_reset(design);
+    for (auto module : design->selected_modules())
+        coverage_module(design, module, metric, seed);
+    coverage_cost_t after = design_cost(design);
+
+    coverage_cost_t added;
+    added.cells = after.cells - before.cells;
+    added.state_bits = after.state_bits - before.state_bits;
+    return added;
+}
+
+static void report(const std::string &metric, const coverage_cost_t &added, const coverage_cost_t &base){
+    log("  %-10s %8d cells (%+6.1f%%) %10lld state bits (%+6.1f%%)\n", metric.c_str(),
+            added.cells, base.cells ? 100.0 * added.cells / base.cells : 0.0,
+            (long long)added.state_bits, base.state_bits ? 100.0 * added.state_bits / base.state_bits : 0.0);
+}
+
+struct InstrumentCoveragePass : public Pass {
+	InstrumentCoveragePass() : Pass("instrument_coverage", "instrument designs with a coverage metric") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    instrument_coverage -metric <metric> [options] [selection]\n");
+		log("\n");
+		log("This pass adds coverage counters to the selected modules and their submodules.\n");
+		log("Every instrumented module outputs the number of coverage points hit so far,\n");
+		log("including those of its submodules, as io_covSum. The metrics are:\n");
+		log("\n");
+		log("    difuzzrtl\n");
+		log("        the states of the XOR-folded control registers, as in\n");
+		log("        difuzzrtl_instrument. Like that pass, this also adds the metaReset\n");
+		log("        input that clears every flip-flop.\n");
+		log("    toggle\n");
+		log("        the rising and the falling edge of every flip-flop bit\n");
+		log("    mux\n");
+		log("        every select value of a $mux and every case of a $pmux\n");
+		log("    fsm\n");
+		log("        the transitions of the state registers found by fsm_detect, which is run\n");
+		log("        first and marks them with the fsm_encoding attribute\n");
+		log("    ctrlreg\n");
+		log("        the values of every control register on its own\n");
+		log("\n");
+		log("The added cells and state bits are reported relative to the design. More cells\n");
+		log("cost simulation time in every cycle, more state bits cost memory and cache.\n");
+		log("\n");
+		log("Options:\n");
+		log("\n");
+		log("    -metric <metric>\n");
+		log("        the coverage metric to instrument\n");
+		log("\n");
+		log("    -estimate\n");
+		log("        instrument copies of the design with every metric and only report the\n");
+		log("        costs, the design is not changed\n");
+		log("\n");
+		log("    -seed number\n");
+		log("        seed of the difuzzrtl metric, see difuzzrtl_instrument\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		std::string metric;
+		bool estimate = false;
+		uint64_t seed = 0;
+
+		log_header(design, "Executing INSTRUMENT_COVERAGE pass.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-metric" && argidx+1 < args.size()) {
+				metric = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-estimate") {
+				estimate = true;
+				continue;
+			}
+			if (args[argidx] == "-seed" && argidx+1 < args.size()) {
+				seed = strtoull(args[++argidx].c_str(), nullptr, 0);
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		if (!estimate && std::find(metrics.begin(), metrics.end(), metric) == metrics.end())
+			log_cmd_error("Unknown or missing metric `%s', expected one of difuzzrtl, toggle, mux, fsm or ctrlreg!\n", metric.c_str());
+
+		coverage_cost_t base = design_cost(design);
+		log("Design: %d cells, %lld state bits.\n", base.cells, (long long)base.state_bits);
+
+		if (!estimate) {
+			coverage_cost_t added = instrument(design, metric, seed);
+			log("Added by the coverage metric:\n");
+			report(metric, added, base);
+			return;
+		}
+
+		dict<std::string, coverage_cost_t> costs;
+		for (auto &m : metrics) {
+			RTLIL::Design *copy = new RTLIL::Design;
+			for (auto module : design->modules())
+				copy->add(module->clone());
+			copy->selection_stack.back() = design->selection();
+			costs[m] = instrument(copy, m, seed);
+			delete copy;
+		}
+		log("Estimated costs of the coverage metrics:\n");
+		for (auto &m : metrics)
+			report(m, costs.at(m), base);
+	}
+} InstrumentCoveragePass;
+
+PRIVATE_NAMESPACE_END
@@ -0,0 +1,60 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/register.h"
+#include "kernel/log.h"
+#include "patch.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct ApplyBugPass : public Pass {
+	ApplyBugPass() : Pass("apply_bug", "rebuild a buggy design from a bug patch") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    apply_bug <bug directory>\n");
+		log("\n");
+		log("This pass applies the bug.json patch written by inject_amt -patch or\n");
+		log("inject_driver -patch to the current design. If the current design is empty,\n");
+		log("the reference design named in the patch is read from the parent directory\n");
+		log("of the bug directory first.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		log_header(design, "Executing APPLY_BUG pass (rebuilding a buggy design from a bug patch).\n");
+
+		if (args.size() != 2)
+			log_cmd_error("Missing or extra bug directory argument!\n");
+		std::string bug_directory = args[1];
+		while (bug_directory.size() > 1 && bug_directory.back() == '/')
+			bug_directory.pop_back();
+
+		json11::Json patch = read_patch(bug_directory);
+
+		load_reference(design, bug_directory, patch);
+
+		log("Applying %s bug from %s.\n", patch["kind"].string_value().c_str(), bug_directory.c_str());
+		apply_patch(design, patch);
+	}
+} ApplyBugPass;
+
+PRIVATE_NAMESPACE_END
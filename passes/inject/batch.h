@@ -0,0 +1,305 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/satgen.h"
+#include "selection.h"
+#include "patch.h"
+#include "verify.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+struct verify_options_t {
+	std::vector<std::pair<std::string, std::string>> sets, sets_init;
+	std::vector<std::string> observables;
+	int max_sensitization = 20, max_propagation = 32, timeout = 0;
+	bool set_init_zero = false, share = false, hierarchical = false, coi = false;
+};
+
+// Returns the port with the given name, adding it to the module and to every module above it if needed
+static RTLIL::Wire *export_port(RTLIL::Design *design, RTLIL::Module *module, RTLIL::IdString name, int width, bool output)
+{
+	RTLIL::Wire *port = module->wire(name);
+	if (port) return port;
+
+	port = module->addWire(name, width);
+	port->port_input = !output;
+	port->port_output = output;
+	module->fixup_ports();
+
+	for (auto parent : design->modules()) {
+		std::vector<RTLIL::Cell *> instances;
+		for (auto cell : parent->cells())
+			if (cell->type == module->name)
+				instances.push_back(cell);
+		if (output && GetSize(instances) > 1)
+			log_cmd_error("Module %s is instantiated more than once in module %s!\n", log_id(module), log_id(parent));
+		for (auto cell : instances)
+			cell->setPort(name, export_port(design, parent, name, width, output));
+	}
+
+	return port;
+}
+
+// Shared modules keep their name and are only added once, as black boxes
+static RTLIL::Module *clone_hierarchy(RTLIL::Design *design, RTLIL::Design *miter_design, std::string prefix, RTLIL::IdString top,
+		const pool<RTLIL::IdString> &shared = pool<RTLIL::IdString>())
+{
+	dict<RTLIL::IdString, RTLIL::IdString> names;
+	for (auto module : design->modules())
+		names[module->name] = shared.count(module->name) ? module->name : RTLIL::IdString("\\" + prefix + RTLIL::unescape_id(module->name));
+
+	for (auto module : design->modules()) {
+		if (miter_design->module(names.at(module->name)))
+			continue;
+		RTLIL::Module *clone = module->clone();
+		clone->name = names.at(module->name);
+		if (shared.count(module->name))
+			clone->makeblackbox();
+		miter_design->add(clone);
+		for (auto cell : clone->cells())
+			if (names.count(cell->type))
+				cell->type = names.at(cell->type);
+	}
+
+	return miter_design->module(names.at(top));
+}
+
+// Returns the key that bugs sharing one miter have in common
+static std::string patch_location(const json11::Json &patch)
+{
+	std::string kind = patch["kind"].string_value();
+	return kind + " " + patch["module"].string_value() + " " + (kind == "amt" ? patch["cell"].dump() : patch["target"].dump());
+}
+
+// Verifies bugs with the same patch location against the reference design. The host side of
+// the miter contains every bug at once behind a free bug select input, so the miter is
+// synthesized once and every bug is a single assumption on one incremental SAT solver.
+static std::vector<verify_result_t> verify_patches(RTLIL::Design *design, RTLIL::Module *top, const std::vector<json11::Json> &patches,
+		const verify_options_t &options, std::function<void(int, const verify_result_t &)> on_result = nullptr)
+{
+	const json11::Json &first = patches.front();
+	std::string kind = first["kind"].string_value();
+	for (auto &patch : patches)
+		if (patch_location(patch) != patch_location(first))
+			log_cmd_error("All bugs of a batch have to target the same %s!\n", kind == "amt" ? "AMT cell" : "wire");
+	if (!design->module(first["module"].string_value()))
+		log_cmd_error("Can not find module %s!\n", first["module"].string_value().c_str());
+
+	// Modules that do not contain the buggy module are only needed once in a hierarchical miter
+	pool<RTLIL::IdString> shared;
+	if (options.hierarchical) {
+		pool<RTLIL::IdString> path = bug_path(design, {RTLIL::IdString(first["module"].string_value())});
+		for (auto module : design->modules())
+			if (!path.count(module->name))
+				shared.insert(module->name);
+	}
+
+	// The miter is built in a separate design to leave the reference untouched, the errors
+	// of a single bug are thrown past it by log_cmd_error
+	std::unique_ptr<RTLIL::Design> miter_design(new RTLIL::Design);
+	RTLIL::Module *host_top = clone_hierarchy(design, miter_design.get(), "host_", top->name, shared);
+	RTLIL::Module *reference_top = clone_hierarchy(design, miter_design.get(), "reference_", top->name, shared);
+	RTLIL::Module *host_module = miter_design->module("\\host_" + RTLIL::unescape_id(first["module"].string_value()));
+	RTLIL::Module *reference_module = miter_design->module("\\reference_" + RTLIL::unescape_id(first["module"].string_value()));
+
+	int num_bugs = GetSize(patches);
+	int bug_width = ceil_log2(num_bugs + 1);
+	RTLIL::SigSpec bug_select = export_port(miter_design.get(), host_module, "\\injection_bug", bug_width, false);
+	RTLIL::SigSpec bug_enables, bug_outputs;
+	std::vector<std::vector<selection_t>> bug_selections;
+	RTLIL::SigSpec host_select, host_output, reference_select, reference_output;
+
+	if (kind == "amt") {
+		RTLIL::Cell *host_cell = host_module->cell(first["cell"].string_value());
+		RTLIL::Cell *reference_cell = reference_module->cell(first["cell"].string_value());
+		if (!host_cell || !reference_cell)
+			log_cmd_error("Can not find AMT cell %s!\n", first["cell"].string_value().c_str());
+
+		for (int i = 0; i < num_bugs; ++i) {
+			RTLIL::Cell *bug_cell = host_module->addCell(NEW_ID, host_cell);
+			bug_cell->setParam(ID::STATE_TABLE, RTLIL::Const::from_string(patches.at(i)["state_table"].string_value()));
+			bug_cell->setPort(ID::A, sig_from_json(host_module, patches.at(i)["a"]));
+			bug_cell->setPort(ID::Y, host_module->addWire(NEW_ID, GetSize(host_cell->getPort(ID::Y))));
+			bug_outputs.append(bug_cell->getPort(ID::Y));
+			bug_selections.push_back(std::vector<selection_t>());
+			copy_from_cell(bug_cell, bug_selections.back());
+		}
+
+		host_select = host_cell->getPort(ID::S);
+		host_output = host_cell->getPort(ID::Y);
+		host_cell->setPort(ID::Y, host_module->addWire(NEW_ID, GetSize(host_output)));
+		for (int i = 0; i < num_bugs; ++i)
+			bug_enables.append(host_module->Eq(NEW_ID, bug_select, RTLIL::Const(i, bug_width)));
+		host_module->addPmux(NEW_ID, host_cell->getPort(ID::Y), bug_outputs, bug_enables, host_output);
+
+		reference_select = reference_cell->getPort(ID::S);
+		reference_output = reference_cell->getPort(ID::Y);
+	} else {
+		RTLIL::SigSpec target = sig_from_json(host_module, first["target"]);
+		for (int i = 0; i < num_bugs; ++i)
+			bug_outputs.append(sig_from_json(host_module, patches.at(i)["driver"]));
+
+		// Redirect the target to a fresh wire and drive it by a bug select multiplexer
+		RTLIL::Wire *bug_wire = host_module->addWire(NEW_ID, GetSize(target));
+		json11::Json::object redirect = first.object_items();
+		redirect["module"] = host_module->name.str();
+		redirect["driver"] = sig_to_json(bug_wire);
+		redirect["buggy"] = false;
+		json11::Json undo = apply_patch(miter_design.get(), redirect);
+		for (int i = 0; i < num_bugs; ++i)
+			bug_enables.append(host_module->Eq(NEW_ID, bug_select, RTLIL::Const(i, bug_width)));
+		host_module->addPmux(NEW_ID, sig_from_json(host_module, undo["driver"]), bug_outputs, bug_enables, bug_wire);
+
+		host_output = target;
+		reference_output = sig_from_json(reference_module, first["target"]);
+	}
+
+	if (GetSize(host_select))
+		host_module->connect(export_port(miter_design.get(), host_module, "\\injection_select", GetSize(host_select), true), host_select);
+	host_module->connect(export_port(miter_design.get(), host_module, "\\injection_output", GetSize(host_output), true), host_output);
+	if (GetSize(reference_select))
+		reference_module->connect(export_port(miter_design.get(), reference_module, "\\injection_select", GetSize(reference_select), true), reference_select);
+	reference_module->connect(export_port(miter_design.get(), reference_module, "\\injection_output", GetSize(reference_output), true), reference_output);
+
+	for (auto side : {host_top, reference_top}) {
+		RTLIL::SigSpec side_observables;
+		for (auto observable : options.observables) {
+			RTLIL::Wire *observable_wire = side->wire("\\" + observable);
+			if (!observable_wire) log_cmd_error("Observable %s is missing!\n", observable.c_str());
+			side_observables.append(observable_wire);
+		}
+		side->connect(export_port(miter_design.get(), side, "\\injection_observables", GetSize(side_observables), true), side_observables);
+	}
+
+	RTLIL::Module *miter_module = miter_design->addModule("\\miter");
+	RTLIL::Cell *host_cell = miter_module->addCell(ID(host), host_top->name);
+	RTLIL::Cell *reference_cell = miter_module->addCell(ID(reference), reference_top->name);
+	for (auto host_wire : host_top->wires())
+	{
+		if (host_wire->port_input)
+		{
+			std::string name = host_wire->name == "\\injection_bug" ? "\\injection_bug" : "\\in_" + RTLIL::unescape_id(host_wire->name);
+			RTLIL::Wire *w = miter_module->addWire(name, host_wire->width);
+			w->port_input = true;
+
+			host_cell->setPort(host_wire->name, w);
+			if (reference_top->wire(host_wire->name))
+				reference_cell->setPort(host_wire->name, w);
+		}
+
+		if (host_wire->port_output && host_wire->name.begins_with("\\injection_"))
+		{
+			RTLIL::Wire *w_host = miter_module->addWire("\\host_" + RTLIL::unescape_id(host_wire->name), host_wire->width);
+			w_host->port_output = true;
+			RTLIL::Wire *w_reference = miter_module->addWire("\\reference_" + RTLIL::unescape_id(host_wire->name), host_wire->width);
+			w_reference->port_output = true;
+
+			host_cell->setPort(host_wire->name, w_host);
+			reference_cell->setPort(host_wire->name, w_reference);
+		}
+	}
+	miter_module->fixup_ports();
+
+	log("Synthesizing shared miter for %d bugs.\n", num_bugs);
+	pool<RTLIL::IdString> bug_modules;
+	if (options.hierarchical)
+		bug_modules = {host_module->name, reference_module->name};
+	synthetize_miter(miter_design.get(), miter_module->name.str(), bug_modules);
+	miter_module = miter_design->module("\\miter");
+	if (options.coi) {
+		std::vector<std::string> constraints;
+		for (auto &set : options.sets)
+			constraints.insert(constraints.end(), {set.first, set.second});
+		for (auto &set : options.sets_init)
+			constraints.insert(constraints.end(), {set.first, set.second});
+		reduce_miter(miter_design.get(), miter_module, constraints);
+	}
+	if (options.share)
+		share_miter(miter_design.get(), miter_module, options.set_init_zero);
+	std::vector<black_box_t> black_boxes;
+	if (options.hierarchical)
+		black_boxes = abstract_black_boxes(miter_design.get(), miter_module);
+
+	std::vector<verify_result_t> results;
+	{
+		SatHelper sathelper(miter_design.get(), miter_module, false, false);
+		sathelper.sets = options.sets;
+		sathelper.timeout = options.timeout;
+		sathelper.sets_init = options.sets_init;
+		sathelper.set_init_zero = options.set_init_zero;
+
+		RTLIL::SigSpec miter_bug(miter_module->wire("\\injection_bug"));
+		RTLIL::SigSpec miter_select, miter_host_output(miter_module->wire("\\host_injection_output")), miter_reference_output(miter_module->wire("\\reference_injection_output"));
+		RTLIL::SigSpec miter_host_observables(miter_module->wire("\\host_injection_observables")), miter_reference_observables(miter_module->wire("\\reference_injection_observables"));
+		if (miter_module->wire("\\host_injection_select"))
+			miter_select = miter_module->wire("\\host_injection_select");
+
+		BugVerifier verifier(sathelper, options.max_sensitization, options.max_propagation);
+		verifier.black_boxes = black_boxes;
+		for (int i = 0; i < num_bugs; ++i) {
+			log("\nVerifying bug %d of %d.\n", i + 1, num_bugs);
+
+			// The bug select input is free, so it is fixed at every time step
+			std::vector<int> bug_literals;
+			for (int step = 1; step <= max(options.max_sensitization, options.max_propagation); ++step)
+				bug_literals.push_back(sathelper.satgen.signals_eq(miter_bug, RTLIL::Const(i, bug_width), step));
+			std::vector<int> assumptions = {sathelper.ez->expression(ezSAT::OpAnd, bug_literals)};
+
+			std::vector<RTLIL::SigSig> selects;
+			if (kind == "amt") {
+				for (auto &selection : bug_selections.at(i)) {
+					if (!selection.buggy) continue;
+					RTLIL::SigSpec select_circuit, select_selection;
+					for (size_t j = 0; j < selection.select.bits.size(); j++) {
+						if (selection.select.bits.at(j) == RTLIL::State::S0 || selection.select.bits.at(j) == RTLIL::State::S1) {
+							select_circuit.append(miter_select[j]);
+							select_selection.append(selection.select.bits.at(j));
+						}
+					}
+					selects.push_back(RTLIL::SigSig(select_circuit, select_selection));
+				}
+			}
+
+			results.push_back(verifier.verify([&](int step) {
+				int output_differs = sathelper.ez->NOT(sathelper.satgen.signals_eq(miter_host_output, miter_reference_output, step));
+				if (kind != "amt")
+					return output_differs;
+				std::vector<int> clause;
+				for (auto &select : selects)
+					clause.push_back(sathelper.satgen.signals_eq(select.first, select.second, step));
+				return sathelper.ez->AND(sathelper.ez->expression(ezSAT::OpOr, clause), output_differs);
+			}, [&](int step) {
+				return sathelper.ez->NOT(sathelper.satgen.signals_eq(miter_host_observables, miter_reference_observables, step));
+			}, assumptions));
+			if (on_result)
+				on_result(i, results.back());
+		}
+	}
+
+	return results;
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/register.h"
+#include "kernel/log.h"
+#include "design_cache.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+struct cached_design_t {
+	std::string filename, path;
+	RTLIL::Design *design;
+};
+
+static dict<std::string, cached_design_t> cached_designs;
+
+// Resolves the file name, so that e.g. bugs/reference.rtlil and ./bugs/reference.rtlil are the
+// same file. A name that can not be resolved is kept as it is.
+static std::string resolve_path(const std::string &filename)
+{
+#ifdef _WIN32
+	char buffer[_MAX_PATH];
+	if (_fullpath(buffer, filename.c_str(), _MAX_PATH))
+		return buffer;
+#else
+	char *resolved = realpath(filename.c_str(), nullptr);
+	if (resolved) {
+		std::string path = resolved;
+		free(resolved);
+		return path;
+	}
+#endif
+	return filename;
+}
+
+RTLIL::Design *design_cache_find(const std::string &name)
+{
+	auto it = cached_designs.find(name);
+	if (it != cached_designs.end())
+		return it->second.design;
+	std::string path = resolve_path(name);
+	for (auto &entry : cached_designs)
+		if (entry.second.path == path)
+			return entry.second.design;
+	return nullptr;
+}
+
+struct DesignCachePass : public Pass {
+	DesignCachePass() : Pass("design_cache", "keep parsed reference designs in memory") { }
+	void on_shutdown() override {
+		// The designs have to go before yosys_shutdown() tears down the kernel
+		for (auto &it : cached_designs)
+			delete it.second.design;
+		cached_designs.clear();
+	}
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    design_cache -load <name> <file> [-script <commands>]\n");
+		log("\n");
+		log("Reads the file into a design of its own and keeps it in memory under the given\n");
+		log("name. The optional commands, e.g. \"opt\", are run on the cached design once.\n");
+		log("They must not rename the cells and wires that bug patches refer to.\n");
+		log("\n");
+		log("    design_cache -clone <name>\n");
+		log("\n");
+		log("Replaces the current design by a copy of the cached design. Copying the modules\n");
+		log("skips parsing and the commands of -load, which dominate the cost of starting\n");
+		log("the verification of a bug in long-running batch jobs.\n");
+		log("\n");
+		log("    design_cache -drop <name>\n");
+		log("    design_cache -list\n");
+		log("\n");
+		log("Removes a cached design, lists the cached designs.\n");
+		log("\n");
+		log("When the current design is empty, apply_bug, verify_batch and verify_bugs copy\n");
+		log("the reference design of a patch from the cache if it was loaded from the same\n");
+		log("file as the patch refers to, instead of reading it again. Both file names are\n");
+		log("resolved to absolute paths first, so they do not have to be spelled the same.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		std::string load_name, load_filename, script, clone_name, drop_name;
+		bool list = false;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-load" && argidx+2 < args.size()) {
+				load_name = args[++argidx];
+				load_filename = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-script" && argidx+1 < args.size()) {
+				script = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-clone" && argidx+1 < args.size()) {
+				clone_name = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-drop" && argidx+1 < args.size()) {
+				drop_name = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-list") {
+				list = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design, false);
+
+		if (!load_name.empty()) {
+			log_header(design, "Loading %s into the design cache as %s.\n", load_filename.c_str(), load_name.c_str());
+			RTLIL::Design *cached = new RTLIL::Design;
+			run_frontend(load_filename, "auto", cached);
+			if (!script.empty())
+				Pass::call(cached, script);
+			if (cached_designs.count(load_name))
+				delete cached_designs.at(load_name).design;
+			cached_designs[load_name] = cached_design_t{load_filename, resolve_path(load_filename), cached};
+		}
+
+		if (!clone_name.empty()) {
+			RTLIL::Design *cached = design_cache_find(clone_name);
+			if (!cached)
+				log_cmd_error("No design cached as `%s'!\n", clone_name.c_str());
+			design_cache_clone(cached, design);
+			log("Cloned %d modules of cached design %s.\n", GetSize(design->modules()), clone_name.c_str());
+		}
+
+		if (!drop_name.empty()) {
+			auto it = cached_designs.find(drop_name);
+			if (it == cached_designs.end())
+				log_cmd_error("No design cached as `%s'!\n", drop_name.c_str());
+			delete it->second.design;
+			cached_designs.erase(it);
+		}
+
+		if (list)
+			for (auto &it : cached_designs)
+				log("%s: %s, %d modules\n", it.first.c_str(), it.second.filename.c_str(), GetSize(it.second.design->modules()));
+	}
+} DesignCachePass;
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,45 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef DESIGN_CACHE_H
+#define DESIGN_CACHE_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Designs kept in memory by design_cache, found by their cache name or by the file they were read
+// from. Returns nullptr if there is no such design.
+RTLIL::Design *design_cache_find(const std::string &name);
+
+// Replaces the contents of the design by copies of the modules of the cached design
+static void design_cache_clone(RTLIL::Design *cached, RTLIL::Design *design)
+{
+	for (auto module : design->modules().to_vector())
+		design->remove(module);
+	for (auto module : cached->modules())
+		design->add(module->clone());
+	design->selection_vars = cached->selection_vars;
+	design->selection_stack.clear();
+	design->selection_stack.push_back(RTLIL::Selection());
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
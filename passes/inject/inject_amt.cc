@@ -32,19 +32,207 @@
 #include <string.h>
 #include <sys/stat.h>
 #include "selection.h"
+#include "workers.h"
+#include "patch.h"
+#include "rng.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 static void write_design(RTLIL::Design *design, std::string output_directory, int index){
-	std::string host_directory = output_directory + "/" + std::to_string(index);
-	if (mkdir(host_directory.c_str(), 0755)){
-		log_error("Error creating bug directory: %s.\n", strerror(errno));
-	}
+	std::string host_directory = create_bug_directory(output_directory, index);
 	// TODO remove this call maybe
 	Pass::call(design, "write_rtlil " + host_directory + "/host_amt.rtlil");
 }
 
+struct amt_bugs_t {RTLIL::Cell *cell; std::vector<selection_t> selections; std::vector<std::vector<selection_t>> bugs;};
+
+static void write_bugs(RTLIL::Design *design, std::string output_directory, std::vector<amt_bugs_t> &amt_bugs, int first_index, int last_index, bool patch){
+	int index = 0;
+	for (auto &amt : amt_bugs) {
+		if (index >= last_index) break;
+		if (index + GetSize(amt.bugs) <= first_index) {
+			index += GetSize(amt.bugs);
+			continue;
+		}
+
+		amt.cell->attributes[ID(buggy)] = RTLIL::Const("buggy");
+		amt.cell->getPort(ID::Y).as_wire()->attributes[ID(buggy)] = RTLIL::Const("buggy");
+		for (auto &bug : amt.bugs) {
+			if (index >= first_index && index < last_index) {
+				copy_to_cell(amt.cell, bug);
+				if (patch) write_patch(create_bug_directory(output_directory, index + 1), amt_patch(amt.cell, "reference.rtlil"));
+				else write_design(design, output_directory, index + 1);
+			}
+			++index;
+		}
+		copy_to_cell(amt.cell, amt.selections);
+		amt.cell->attributes.erase(ID(buggy));
+		amt.cell->getPort(ID::Y).as_wire()->attributes.erase(ID(buggy));
+	}
+}
+
+// The bug space of an AMT: every defined select bit can be relaxed to a don't care, every
+// don't care can be restricted to 0 or 1 and every selection can be dropped
+struct amt_space_t {RTLIL::Cell *cell; std::vector<selection_t> selections; int64_t num_relax = 0, num_restrict = 0, num_drop = 0;};
+
+struct amt_bug_t {std::string kind; int selection = -1, bit = -1; RTLIL::State value = RTLIL::State::Sx;};
+
+static int64_t space_size(const amt_space_t &space)
+{
+	return space.num_relax + space.num_restrict + space.num_drop;
+}
+
+static amt_space_t enumerate_space(RTLIL::Cell *cell, const std::vector<selection_t> &selections)
+{
+	amt_space_t space;
+	space.cell = cell;
+	space.selections = selections;
+	for (auto &selection : selections) {
+		if (selection.output.is_fully_undef()) continue;
+		for (auto bit : selection.select.bits) {
+			if (bit == RTLIL::State::S0 || bit == RTLIL::State::S1) space.num_relax++;
+			else if (bit == RTLIL::State::Sa) space.num_restrict += 2;
+		}
+	}
+	space.num_drop = GetSize(selections);
+	return space;
+}
+
+// Maps an index of the bug space to the bug, in the order of enumerate_space
+static amt_bug_t decode_bug(const amt_space_t &space, int64_t index)
+{
+	amt_bug_t bug;
+	for (int i = 0; i < GetSize(space.selections); ++i) {
+		const selection_t &selection = space.selections.at(i);
+		if (selection.output.is_fully_undef()) continue;
+		for (int j = 0; j < GetSize(selection.select.bits); ++j) {
+			RTLIL::State bit = selection.select.bits.at(j);
+			int64_t size = bit == RTLIL::State::S0 || bit == RTLIL::State::S1 ? 1 : bit == RTLIL::State::Sa ? 2 : 0;
+			if (index < size) {
+				bug.kind = size == 1 ? "relax" : "restrict";
+				bug.selection = i;
+				bug.bit = j;
+				bug.value = size == 1 ? RTLIL::State::Sa : index ? RTLIL::State::S1 : RTLIL::State::S0;
+				return bug;
+			}
+			index -= size;
+		}
+	}
+	log_assert(index < space.num_drop);
+	bug.kind = "drop";
+	bug.selection = index;
+	return bug;
+}
+
+static std::vector<selection_t> apply_bug(const std::vector<selection_t> &selections, const amt_bug_t &bug)
+{
+	std::vector<selection_t> bug_selections = selections;
+	if (bug.kind == "drop") {
+		bug_selections.erase(bug_selections.begin() + bug.selection);
+		return bug_selections;
+	}
+	selection_t selection = bug_selections.at(bug.selection);
+	selection.select.bits.at(bug.bit) = bug.value;
+	selection.buggy = true;
+	// A relaxed selection matches more inputs, it is moved to the front to take priority
+	if (bug.kind == "relax") {
+		bug_selections.erase(bug_selections.begin() + bug.selection);
+		bug_selections.insert(bug_selections.begin(), selection);
+	} else
+		bug_selections.at(bug.selection) = selection;
+	return bug_selections;
+}
+
+// Splits the bugs over the AMTs in proportion to the size of their bug spaces (largest remainder)
+static std::vector<int> allocate_bugs(const std::vector<amt_space_t> &spaces, int num_bugs)
+{
+	std::vector<int> allocation;
+	int64_t total = 0;
+	for (auto &space : spaces)
+		total += space_size(space);
+	if (num_bugs >= total) {
+		for (auto &space : spaces)
+			allocation.push_back(int(space_size(space)));
+		return allocation;
+	}
+
+	std::vector<std::pair<int64_t, int>> remainders;
+	int allocated = 0;
+	for (int i = 0; i < GetSize(spaces); ++i) {
+		int64_t share = int64_t(num_bugs) * space_size(spaces.at(i));
+		allocation.push_back(int(share / total));
+		allocated += allocation.back();
+		remainders.push_back(std::make_pair(-(share % total), i));
+	}
+	std::sort(remainders.begin(), remainders.end());
+	for (int i = 0; allocated < num_bugs; ++i, ++allocated)
+		allocation.at(remainders.at(i).second)++;
+	return allocation;
+}
+
+// Draws a uniform sample of k distinct indices of [0, n) with reservoir sampling, in ascending order
+static std::vector<int64_t> sample_indices(CounterRng &rng, int64_t n, int k)
+{
+	std::vector<int64_t> reservoir;
+	for (int64_t i = 0; i < n; ++i) {
+		if (GetSize(reservoir) < k)
+			reservoir.push_back(i);
+		else {
+			uint64_t j = rng.next() % uint64_t(i + 1);
+			if (j < uint64_t(k))
+				reservoir.at(j) = i;
+		}
+	}
+	std::sort(reservoir.begin(), reservoir.end());
+	return reservoir;
+}
+
+static std::string state_to_string(RTLIL::State state)
+{
+	return state == RTLIL::State::S0 ? "0" : state == RTLIL::State::S1 ? "1" : state == RTLIL::State::Sa ? "-" : "x";
+}
+
+static void write_manifest(std::string filename, uint64_t seed, int num_bugs, const std::vector<amt_space_t> &spaces, const std::vector<std::vector<amt_bug_t>> &plan)
+{
+	json11::Json::array cells;
+	int64_t total = 0;
+	int index = 0;
+	for (int i = 0; i < GetSize(spaces); ++i) {
+		const amt_space_t &space = spaces.at(i);
+		json11::Json::array bugs;
+		for (auto &bug : plan.at(i)) {
+			json11::Json::object entry{{"bug", ++index}, {"kind", bug.kind}, {"selection", bug.selection}};
+			if (bug.kind != "drop") {
+				entry["bit"] = bug.bit;
+				entry["value"] = state_to_string(bug.value);
+			}
+			bugs.push_back(entry);
+		}
+		cells.push_back(json11::Json::object{
+			{"module", space.cell->module->name.str()},
+			{"cell", space.cell->name.str()},
+			{"selections", GetSize(space.selections)},
+			{"space", json11::Json::object{{"relax", double(space.num_relax)}, {"restrict", double(space.num_restrict)}, {"drop", double(space.num_drop)}}},
+			{"sampled", GetSize(plan.at(i))},
+			{"bugs", bugs},
+		});
+		total += space_size(space);
+	}
+	json11::Json manifest = json11::Json::object{
+		{"seed", std::to_string(seed)},
+		{"requested", num_bugs},
+		{"space", double(total)},
+		{"sampled", index},
+		{"cells", cells},
+	};
+
+	std::ofstream f(filename);
+	if (!f)
+		log_error("Can't open manifest `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+	f << manifest.dump() << "\n";
+}
+
 struct InjectAmtPass : public Pass {
 	InjectAmtPass() : Pass("inject_amt", "produce designs with buggy AMTs") { }
 	void help() override
@@ -60,14 +248,44 @@ struct InjectAmtPass : public Pass {
 		log("    -output-dir directory\n");
 		log("        generated designs are stored in the directory\n");
 		log("    -num-bugs number\n");
-		log("        the desired number of bugs to be injected into the design\n");
+		log("        the number of bugs to be injected into the design (default: 1000).\n");
+		log("        The bug space of every AMT is enumerated first: every defined select\n");
+		log("        bit can be relaxed to a don't care, every don't care can be\n");
+		log("        restricted to 0 or 1 and every selection can be dropped. The bugs are\n");
+		log("        split over the AMTs in proportion to the size of their bug spaces and\n");
+		log("        drawn uniformly without repetition within every AMT, so exactly this\n");
+		log("        number of bugs is generated unless the bug space is smaller.\n");
+		log("    -plan\n");
+		log("        only write the manifest, do not generate any bugs\n");
+		log("    -patch\n");
+		log("        write the unmodified design once as reference.rtlil and only a small\n");
+		log("        bug.json patch per bug instead of a full host_amt.rtlil design, the\n");
+		log("        host design can be rebuilt with apply_bug\n");
+		log("    -j number\n");
+		log("        write the generated designs using the given number of worker\n");
+		log("        processes, the output does not depend on the number of workers\n");
+		log("    -seed number\n");
+		log("        seed of the random bug selection (default: 0). The random numbers of\n");
+		log("        every AMT only depend on the seed and the cell name, so the same seed\n");
+		log("        always produces the same bugs.\n");
+		log("    -shard i/N\n");
+		log("        only write the i-th of N equal slices of the bugs, numbered from 0.\n");
+		log("        Shards with the same seed write disjoint bug directories.\n");
+		log("\n");
+		log("The bug spaces and the sampled bugs are described in manifest.json in the\n");
+		log("output directory, the n-th bug of the manifest is written to directory n.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
 		std::string output_directory;
 		int num_bugs = 1000;
-		int bugs_per_module;
-		int index = 0;
+		int num_workers = 1;
+		int shard = 0, num_shards = 1;
+		uint64_t seed = 0;
+		bool patch = false, plan_only = false;
+		std::vector<amt_bugs_t> amt_bugs;
+		int num_total_bugs = 0;
 
 		log_header(design, "Executing InjectAmt pass (producing designs with buggy AMTs).\n");
 
@@ -81,85 +299,84 @@ struct InjectAmtPass : public Pass {
 				num_bugs = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-plan") {
+				plan_only = true;
+				continue;
+			}
+			if (args[argidx] == "-patch") {
+				patch = true;
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_workers = max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-seed" && argidx+1 < args.size()) {
+				seed = strtoull(args[++argidx].c_str(), nullptr, 0);
+				continue;
+			}
+			if (args[argidx] == "-shard" && argidx+1 < args.size()) {
+				parse_shard(args[++argidx], shard, num_shards);
+				continue;
+			}
 		}
 		if (output_directory.empty()) {
 			log_error("Missing mandatory argument -output-dir!\n");
 		}
 
-		bugs_per_module = num_bugs / design->selected_modules().size();
-		if (!bugs_per_module) bugs_per_module = 1;
-
-		// TODO create hosts directory
-
+		// Planning: enumerate the exact bug space of every AMT, then sample the bugs
+		std::vector<amt_space_t> spaces;
 		for (auto module : design->selected_modules()) {
-			int num_amt_cells = 0;
 			for (auto cell : module->selected_cells()) {
 				if (cell->type == ID($amt)) {
 					std::vector<selection_t> selections;
 					copy_from_cell(cell, selections);
 					if (selections.size() < 4) continue;
-					++num_amt_cells;
+					spaces.push_back(enumerate_space(cell, selections));
 				}
 			}
-			if (!num_amt_cells) continue;
-			int bugs_per_cell = bugs_per_module / num_amt_cells;
-			if (!bugs_per_cell) bugs_per_cell = 1;
+		}
 
-			for (auto cell : module->selected_cells()) {
-				if (cell->type == ID($amt)) {
-					std::vector<selection_t> selections;
-					copy_from_cell(cell, selections);
-					if (selections.size() < 4) continue;
-					log_amt(cell, selections);
-
-					std::vector<std::vector<selection_t>> bugs;
-					int selection_index = -1;
-					for (auto &selection : selections) {
-						++selection_index;
-						if (selection.output.is_fully_undef()) continue;
-						for (auto &bit : selection.select.bits) {
-							int one_in = selections.size() * selection.select.size() / bugs_per_cell;
-							if (!one_in) one_in = 1;
-							// if ((rand() % 0xffffffffffff) == 0) {
-							if ((rand() % one_in) == 0) {
-								if (bit == RTLIL::State::S0 || bit == RTLIL::State::S1) {
-									RTLIL::State temp = bit;
-									bit = RTLIL::State::Sa;
-									selection.buggy = true;
-									bugs.push_back(selections);
-									bugs.back().erase(bugs.back().begin() + selection_index);
-									bugs.back().insert(bugs.back().begin(), selection);
-									selection.buggy = false;
-									bit = temp;
-								} else if (bit == RTLIL::State::Sa) {
-									bit = (rand() & 1) ? RTLIL::State::S1 : RTLIL::State::S0;
-									selection.buggy = true;
-									bugs.push_back(selections);
-									selection.buggy = false;
-									bit = RTLIL::State::Sa;
-								}
-							}
-						}
-					}
-
-					for (int i = 0; i < 1; ++i) {
-						std::vector<selection_t> buggy_selections = selections;
-						buggy_selections.erase(buggy_selections.begin()+(rand()%(selections.size() + 1)));
-						bugs.push_back(buggy_selections);
-					}
-
-					cell->attributes[ID(buggy)] = RTLIL::Const("buggy");
-					cell->getPort(ID::Y).as_wire()->attributes[ID(buggy)] = RTLIL::Const("buggy");
-					for (auto &bug : bugs) {
-						copy_to_cell(cell, bug);
-						write_design(design, output_directory, ++index);
-					}
-					copy_to_cell(cell, selections);
-					cell->attributes.erase(ID(buggy));
-					cell->getPort(ID::Y).as_wire()->attributes.erase(ID(buggy));
-				}
-			}
+		std::vector<int> allocation = allocate_bugs(spaces, num_bugs);
+		std::vector<std::vector<amt_bug_t>> plan;
+		for (int i = 0; i < GetSize(spaces); ++i) {
+			const amt_space_t &space = spaces.at(i);
+			CounterRng rng(seed, space.cell->module->name.str() + " " + space.cell->name.str());
+			plan.push_back(std::vector<amt_bug_t>());
+			for (int64_t index : sample_indices(rng, space_size(space), allocation.at(i)))
+				plan.back().push_back(decode_bug(space, index));
+			log("AMT %s.%s: %lld bugs (%lld relax, %lld restrict, %lld drop), sampled %d.\n", log_id(space.cell->module), log_id(space.cell),
+					(long long)space_size(space), (long long)space.num_relax, (long long)space.num_restrict, (long long)space.num_drop, allocation.at(i));
+		}
+
+		write_manifest(output_directory + "/manifest.json", seed, num_bugs, spaces, plan);
+		if (plan_only)
+			return;
+
+		for (int i = 0; i < GetSize(spaces); ++i) {
+			amt_space_t &space = spaces.at(i);
+			if (plan.at(i).empty()) continue;
+			log_amt(space.cell, space.selections);
+			std::vector<std::vector<selection_t>> bugs;
+			for (auto &bug : plan.at(i))
+				bugs.push_back(apply_bug(space.selections, bug));
+			num_total_bugs += GetSize(bugs);
+			amt_bugs.push_back({space.cell, space.selections, bugs});
 		}
+
+		if (patch) Pass::call(design, "write_rtlil " + output_directory + "/reference.rtlil");
+
+		// All random choices are made above, so the bug indices depend neither on the shard nor on the number of workers
+		int shard_first = int((long long)num_total_bugs * shard / num_shards);
+		int shard_size = int((long long)num_total_bugs * (shard + 1) / num_shards) - shard_first;
+		log("Writing %d of %d bugs using %d worker(s).\n", shard_size, num_total_bugs, num_workers);
+		int num_failed = run_workers(num_workers, [&](int worker) {
+			int first_index = shard_first + int((long long)shard_size * worker / num_workers);
+			int last_index = shard_first + int((long long)shard_size * (worker + 1) / num_workers);
+			write_bugs(design, output_directory, amt_bugs, first_index, last_index, patch);
+		});
+		if (num_failed)
+			log_error("%d of %d workers failed.\n", num_failed, num_workers);
 	}
 } InjectAmtPass;
 
@@ -32,15 +32,14 @@
 #include <string.h>
 #include <sys/stat.h>
 #include "selection.h"
+#include "patch.h"
+#include "rng.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 static void write_design(RTLIL::Design *design, std::string output_directory, int index){
-	std::string host_directory = output_directory + "/" + std::to_string(index);
-	if (mkdir(host_directory.c_str(), 0755)){
-		log_error("Error creating bug directory: %s.\n", strerror(errno));
-	}
+	std::string host_directory = create_bug_directory(output_directory, index);
 	Pass::call(design, "write_rtlil " + host_directory + "/host_driver.rtlil");
 }
 
@@ -109,6 +108,17 @@ struct InjectDriverPass : public Pass {
 		log("        generated designs are stored in the directory\n");
 		log("    -num-bugs number\n");
 		log("        the desired number of bugs to be injected into the design\n");
+		log("    -patch\n");
+		log("        write the design once as reference_driver.rtlil and only a small\n");
+		log("        bug.json patch per bug instead of full host and reference designs,\n");
+		log("        the host design can be rebuilt with apply_bug\n");
+		log("    -seed number\n");
+		log("        seed of the random signal selection (default: 0). The random numbers\n");
+		log("        of every module only depend on the seed and the module name, so the\n");
+		log("        same seed always produces the same bugs.\n");
+		log("    -shard i/N\n");
+		log("        only write the i-th of N equal slices of the bugs, numbered from 0.\n");
+		log("        Shards with the same seed write disjoint bug directories.\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -116,6 +126,9 @@ struct InjectDriverPass : public Pass {
 		int num_bugs = 1000;
 		int bugs_per_module;
 		int index = 0;
+		int shard = 0, num_shards = 1;
+		uint64_t seed = 0;
+		bool patch = false;
 
 		log_header(design, "Inject Driver.\n");
 
@@ -129,6 +142,18 @@ struct InjectDriverPass : public Pass {
 				num_bugs = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-patch") {
+				patch = true;
+				continue;
+			}
+			if (args[argidx] == "-seed" && argidx+1 < args.size()) {
+				seed = strtoull(args[++argidx].c_str(), nullptr, 0);
+				continue;
+			}
+			if (args[argidx] == "-shard" && argidx+1 < args.size()) {
+				parse_shard(args[++argidx], shard, num_shards);
+				continue;
+			}
 		}
 		if (output_directory.empty()) {
 			log_error("Missing mandatory argument -output-dir!\n");
@@ -137,10 +162,22 @@ struct InjectDriverPass : public Pass {
 		bugs_per_module = num_bugs / design->selected_modules().size();
 		if (!bugs_per_module) bugs_per_module = 1;
 
+		// Every module produces exactly bugs_per_module bugs, so the slice of a shard is known up front
+		int num_total_bugs = bugs_per_module * GetSize(design->selected_modules());
+		int shard_first = int((long long)num_total_bugs * shard / num_shards);
+		int shard_last = int((long long)num_total_bugs * (shard + 1) / num_shards);
+
+		// All bugs share one reference, so every module is exposed before the first bug
+		if (patch) {
+			for (auto module : design->selected_modules())
+				expose_cells(module);
+			Pass::call(design, "write_rtlil " + output_directory + "/reference_driver.rtlil");
+		}
+
 		for (auto module : design->selected_modules()) {
 			std::set<RTLIL::SigSpec> drivers_set, targets_set;
 
-			expose_cells(module);
+			if (!patch) expose_cells(module);
 			// SigMap sigmap(module);
 			// std::vector<RTLIL::Wire *> public_wires;
 			// for (auto wire : module->selected_wires()) {
@@ -184,10 +221,16 @@ struct InjectDriverPass : public Pass {
 			}
 
 			std::vector<RTLIL::SigSpec> drivers(drivers_set.begin(), drivers_set.end()), targets(targets_set.begin(), targets_set.end());
+			// Keep the numbering of the later modules independent of this one
+			if (drivers.empty() || targets.empty()) {
+				index += bugs_per_module;
+				continue;
+			}
+			CounterRng rng(seed, module->name.str());
 			int start_index = index;
 			while (index-start_index < bugs_per_module) {
-				RTLIL::SigSpec driver = drivers.at(rand() % (int)drivers.size());
-				RTLIL::SigSpec target = targets.at(rand() % (int)targets.size());
+				RTLIL::SigSpec driver = drivers.at(rng(GetSize(drivers)));
+				RTLIL::SigSpec target = targets.at(rng(GetSize(targets)));
 
 				if (!driver.extract(target).empty()) continue;
 
@@ -215,7 +258,17 @@ struct InjectDriverPass : public Pass {
 					RTLIL::SigSpec original_driver = connection.second;
 					// log("before: %s %s\n", log_signal(connection.first), log_signal(connection.second));
 					connection.first.replace(target, driver, &connection.second);
+					module->invalidate_sigmap();
 					if (connection.second == original_driver) break;
+					if (index - 1 < shard_first || index - 1 >= shard_last) {
+						connection.second = original_driver;
+						break;
+					}
+					if (patch) {
+						connection.second = original_driver;
+						write_patch(create_bug_directory(output_directory, index), driver_patch(module, target, driver, "reference_driver.rtlil"));
+						break;
+					}
 					target.as_wire()->attributes[ID(buggy)] = RTLIL::Const("buggy");
 					// log("after: %s %s\n", log_signal(connection.first), log_signal(connection.second));
 					write_design(design, output_directory, index);
@@ -31,6 +31,144 @@ PRIVATE_NAMESPACE_BEGIN
 static SigMap assign_map;
 SigSet<RTLIL::Cell*, RTLIL::sort_by_name_id<RTLIL::Cell>> sig2driver;
 
+// Truth tables are stored as one bitset per output bit with one bit per input minterm. Variable k
+// of the minterm index is the k-th input bit, so 64 minterms are evaluated with every word operation.
+typedef std::vector<uint64_t> truth_table_t;
+
+static const uint64_t minterm_patterns[6] = {
+	0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+	0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL,
+};
+
+// Evaluates the cell for all minterms of the inputs, returns false for unsupported cell types
+static bool eval_truth_tables(RTLIL::Cell *cell, const RTLIL::SigSpec &inputs, const RTLIL::SigSpec &outputs, std::vector<truth_table_t> &tables)
+{
+	if (!cell->type.in(ID($not), ID($and), ID($or), ID($eq)))
+		return false;
+
+	int num_words = GetSize(inputs) > 6 ? 1 << (GetSize(inputs) - 6) : 1;
+	uint64_t valid = GetSize(inputs) >= 6 ? ~uint64_t(0) : (uint64_t(1) << (1 << GetSize(inputs))) - 1;
+	dict<RTLIL::SigBit, int> variables;
+	for (int k = 0; k < GetSize(inputs); ++k)
+		variables[inputs[k]] = k;
+
+	RTLIL::SigSpec y = assign_map(cell->getPort(ID::Y));
+	tables.assign(GetSize(outputs), truth_table_t(num_words));
+
+	// Extends the port like the cell does and returns its bits for the minterms of word w
+	auto port_words = [&](RTLIL::IdString port, int width, int w) {
+		RTLIL::SigSpec sig = assign_map(cell->getPort(port));
+		// As in CellTypes::eval, binary cells are only signed if both operands are
+		bool is_signed = cell->getParam(ID::A_SIGNED).as_bool();
+		if (cell->type != ID($not))
+			is_signed = is_signed && cell->getParam(ID::B_SIGNED).as_bool();
+		sig.extend_u0(width, is_signed);
+		std::vector<uint64_t> words;
+		for (auto bit : sig) {
+			auto it = variables.find(bit);
+			if (it != variables.end())
+				words.push_back(it->second < 6 ? minterm_patterns[it->second] : ((w >> (it->second - 6)) & 1) ? ~uint64_t(0) : 0);
+			else
+				words.push_back(bit == RTLIL::State::S1 ? ~uint64_t(0) : 0);
+		}
+		return words;
+	};
+
+	for (int w = 0; w < num_words; ++w) {
+		std::vector<uint64_t> result(GetSize(y));
+		if (cell->type == ID($eq)) {
+			int width = max(GetSize(cell->getPort(ID::A)), GetSize(cell->getPort(ID::B)));
+			std::vector<uint64_t> a = port_words(ID::A, width, w), b = port_words(ID::B, width, w);
+			uint64_t equal = ~uint64_t(0);
+			for (int i = 0; i < width; ++i)
+				equal &= ~(a[i] ^ b[i]);
+			result[0] = equal;
+		} else {
+			std::vector<uint64_t> a = port_words(ID::A, GetSize(y), w);
+			std::vector<uint64_t> b = cell->type == ID($not) ? a : port_words(ID::B, GetSize(y), w);
+			for (int i = 0; i < GetSize(y); ++i)
+				result[i] = cell->type == ID($not) ? ~a[i] : cell->type == ID($and) ? a[i] & b[i] : a[i] | b[i];
+		}
+		for (int j = 0; j < GetSize(outputs); ++j)
+			for (int i = 0; i < GetSize(y); ++i)
+				if (y[i] == outputs[j]) {
+					tables[j][w] = result[i] & valid;
+					break;
+				}
+	}
+	return true;
+}
+
+// Returns 0 or 1 if the table is constant on the minterms [lo, hi), 2 otherwise
+static int range_value(const truth_table_t &table, uint64_t lo, uint64_t hi)
+{
+	int value = -1;
+	for (uint64_t w = lo / 64; w * 64 < hi; ++w) {
+		uint64_t first = max(lo, w * 64) - w * 64, last = min(hi, w * 64 + 64) - w * 64;
+		uint64_t mask = (last - first == 64 ? ~uint64_t(0) : ((uint64_t(1) << (last - first)) - 1)) << first;
+		uint64_t bits = table[w] & mask;
+		int word_value = bits == 0 ? 0 : bits == mask ? 1 : 2;
+		if (word_value == 2 || (value >= 0 && value != word_value))
+			return 2;
+		value = word_value;
+	}
+	return value;
+}
+
+struct cube_t { uint32_t value, mask; std::vector<bool> output; };
+
+// Espresso-lite two-level minimization. A Shannon expansion on the most significant variable first
+// only ever looks at contiguous minterm ranges and yields a disjoint cover, then cubes with the same
+// output that differ in a single variable are merged through a hash lookup until nothing changes.
+// The cover stays disjoint, so every minterm still matches exactly one row of the AMT table.
+static std::vector<cube_t> minimize(const std::vector<truth_table_t> &tables, int num_inputs)
+{
+	std::vector<cube_t> cubes;
+	std::function<void(int, uint32_t, uint32_t, uint64_t, uint64_t)> expand = [&](int var, uint32_t value, uint32_t mask, uint64_t lo, uint64_t hi) {
+		std::vector<bool> output;
+		for (auto &table : tables) {
+			int bit = range_value(table, lo, hi);
+			if (bit == 2) {
+				uint64_t mid = lo + (hi - lo) / 2;
+				expand(var - 1, value, mask | (1u << var), lo, mid);
+				expand(var - 1, value | (1u << var), mask | (1u << var), mid, hi);
+				return;
+			}
+			output.push_back(bit);
+		}
+		cubes.push_back({value, mask, output});
+	};
+	expand(num_inputs - 1, 0, 0, 0, uint64_t(1) << num_inputs);
+
+	for (bool merged = true; merged;) {
+		merged = false;
+		for (int k = 0; k < num_inputs; ++k) {
+			dict<std::tuple<std::vector<bool>, uint32_t, uint32_t>, int> partners;
+			std::vector<bool> removed(cubes.size());
+			for (int i = 0; i < GetSize(cubes); ++i) {
+				cube_t &cube = cubes[i];
+				if (!(cube.mask & (1u << k))) continue;
+				auto key = std::make_tuple(cube.output, cube.value & ~(1u << k), cube.mask);
+				auto it = partners.find(key);
+				if (it == partners.end()) {
+					partners[key] = i;
+					continue;
+				}
+				cubes[it->second].mask &= ~(1u << k);
+				cubes[it->second].value &= ~(1u << k);
+				removed[i] = true;
+				partners.erase(it);
+				merged = true;
+			}
+			std::vector<cube_t> kept;
+			for (int i = 0; i < GetSize(cubes); ++i)
+				if (!removed[i]) kept.push_back(cubes[i]);
+			cubes.swap(kept);
+		}
+	}
+	return cubes;
+}
+
 // ID($lt), ID($le), ID($eq), ID($ne), ID($eqx), ID($nex), ID($ge), ID($gt)
 // ID($add), ID($sub), ID($mul), ID($div), ID($mod), ID($divfloor), ID($modfloor), ID($pow)
 // ID($shift), ID($shiftx)
@@ -45,20 +183,43 @@ struct InjectExpandPass : public Pass {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    inject_expand [selection]\n");
+		log("    inject_expand [options] [selection]\n");
 		log("\n");
 		log("This pass expands AMT tables.\n");
 		log("\n");
+		log("The truth table of every driver cell is evaluated for 64 input combinations\n");
+		log("per word operation and minimized into a disjoint two-level cover before it is\n");
+		log("merged into the AMT table.\n");
+		log("\n");
+		log("Options:\n");
+		log("\n");
+		log("    -max-inputs number\n");
+		log("        only expand driver cells with at most this many select inputs\n");
+		log("        (default: 8, at most 24)\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
+		int max_inputs = 8;
+
 		log_header(design, "Executing INJECT_EXPAND pass (expanding AMT tables).\n");
-		extra_args(args, 1, design);
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-max-inputs" && argidx+1 < args.size()) {
+				max_inputs = atoi(args[++argidx].c_str());
+				if (max_inputs < 0 || max_inputs > 24)
+					log_cmd_error("The number of inputs has to be between 0 and 24!\n");
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
 
         CellTypes ct(design);
 
 		for (auto module : design->selected_modules()) {
-			assign_map.set(module);
+			assign_map = module->sigmap();
 
 			sig2driver.clear();
 			for (auto cell : module->cells()) {
@@ -130,7 +291,7 @@ struct InjectExpandPass : public Pass {
 							cell_input = filtered_input;
 						}
 						cell_input.remove_const();
-						if (cell_input.size() > 8) continue;
+						if (cell_input.size() > max_inputs) continue;
 
 						// TODO might have to assign map
 						full_output = cell_output;
@@ -143,57 +304,46 @@ struct InjectExpandPass : public Pass {
 						log_flush();
 
 						std::vector<std::pair<RTLIL::Const, RTLIL::Const>> truth_tab;
-						for (unsigned long long i = 0; i < (1ULL << cell_input.size()); i++) {
-							RTLIL::Const in_val(i, cell_input.size());
-							RTLIL::SigSpec A, B, S;
-							if (cell->hasPort(ID::A))
-								A = assign_map(cell->getPort(ID::A));
-							if (cell->hasPort(ID::B))
-								B = assign_map(cell->getPort(ID::B));
-							if (cell->hasPort(ID::S))
-								S = assign_map(cell->getPort(ID::S));
-							A.replace(cell_input, RTLIL::SigSpec(in_val));
-							if (cell->hasPort(ID::A))
-								A.replace(assign_map(cell->getPort(ID::A)), RTLIL::SigSpec(RTLIL::Const(State::S0, A.size())));
-							B.replace(cell_input, RTLIL::SigSpec(in_val));
-							if (cell->hasPort(ID::B))
-								B.replace(assign_map(cell->getPort(ID::B)), RTLIL::SigSpec(RTLIL::Const(State::S0, B.size())));
-							S.replace(cell_input, RTLIL::SigSpec(in_val));
-							if (cell->hasPort(ID::S))
-								S.replace(assign_map(cell->getPort(ID::S)), RTLIL::SigSpec(RTLIL::Const(State::S0, S.size())));
-							log_assert(A.is_fully_const());
-							log_assert(B.is_fully_const());
-							log_assert(S.is_fully_const());
-							RTLIL::SigSpec out_val = cell_output;
-							out_val.replace(full_output, ct.eval(cell, A.as_const(), B.as_const(), S.as_const()));
-							truth_tab.push_back({out_val.as_const(), in_val});
-						}
-
-						bool merged = true;
-						while (merged) {
-							merged = false;
-							for (size_t i = 0; i < truth_tab.size(); ++i) {
-								for (size_t j = i + 1; j < truth_tab.size(); ++j) {
-									if (truth_tab.at(i).first != truth_tab.at(j).first) continue;
-									int matching = 0;
-									int index;
-									for (int k = 0; k < cell_input.size(); ++k) {
-										if (truth_tab.at(i).second.bits.at(k) == truth_tab.at(j).second.bits.at(k)) {
-											++matching;
-										} else {
-											index = k;
-										}
-									}
-									if (matching != cell_input.size() - 1) continue;
-
-									truth_tab.at(i).second.bits.at(index) = State::Sa;
-									truth_tab.erase(truth_tab.begin() + j);
-									--j;
-									merged = true;
-									break;
-								}
+						std::vector<truth_table_t> tables;
+						if (!eval_truth_tables(cell, cell_input, cell_output, tables)) {
+							// Cells without a bit-parallel model are evaluated minterm by minterm
+							tables.assign(GetSize(cell_output), truth_table_t(GetSize(cell_input) > 6 ? 1 << (GetSize(cell_input) - 6) : 1));
+							for (unsigned long long i = 0; i < (1ULL << cell_input.size()); i++) {
+								RTLIL::Const in_val(i, cell_input.size());
+								RTLIL::SigSpec A, B, S;
+								if (cell->hasPort(ID::A))
+									A = assign_map(cell->getPort(ID::A));
+								if (cell->hasPort(ID::B))
+									B = assign_map(cell->getPort(ID::B));
+								if (cell->hasPort(ID::S))
+									S = assign_map(cell->getPort(ID::S));
+								A.replace(cell_input, RTLIL::SigSpec(in_val));
+								if (cell->hasPort(ID::A))
+									A.replace(assign_map(cell->getPort(ID::A)), RTLIL::SigSpec(RTLIL::Const(State::S0, A.size())));
+								B.replace(cell_input, RTLIL::SigSpec(in_val));
+								if (cell->hasPort(ID::B))
+									B.replace(assign_map(cell->getPort(ID::B)), RTLIL::SigSpec(RTLIL::Const(State::S0, B.size())));
+								S.replace(cell_input, RTLIL::SigSpec(in_val));
+								if (cell->hasPort(ID::S))
+									S.replace(assign_map(cell->getPort(ID::S)), RTLIL::SigSpec(RTLIL::Const(State::S0, S.size())));
+								log_assert(A.is_fully_const());
+								log_assert(B.is_fully_const());
+								log_assert(S.is_fully_const());
+								RTLIL::SigSpec out_val = cell_output;
+								out_val.replace(full_output, ct.eval(cell, A.as_const(), B.as_const(), S.as_const()));
+								for (int j = 0; j < GetSize(cell_output); ++j)
+									if (out_val[j] == RTLIL::State::S1)
+										tables[j][i / 64] |= uint64_t(1) << (i % 64);
 							}
 						}
+						for (auto &cube : minimize(tables, GetSize(cell_input))) {
+							RTLIL::Const out_val, in_val;
+							for (bool bit : cube.output)
+								out_val.bits.push_back(bit ? State::S1 : State::S0);
+							for (int k = 0; k < GetSize(cell_input); ++k)
+								in_val.bits.push_back(!(cube.mask & (1u << k)) ? State::Sa : (cube.value & (1u << k)) ? State::S1 : State::S0);
+							truth_tab.push_back({out_val, in_val});
+						}
 
 						for (size_t i = 0; i < truth_tab.size(); ++i) {
 							log("%s %s\n", log_signal(truth_tab.at(i).first), log_signal(truth_tab.at(i).second));
@@ -25,6 +25,8 @@
 #include "kernel/consteval.h"
 #include "kernel/sigtools.h"
 #include "kernel/satgen.h"
+#include "verify.h"
+#include "workers.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <algorithm>
@@ -34,33 +36,98 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-static void corrupt_transition(FsmData &fsm_data, FsmData::transition_t &transition)
+static bool is_challenging(const FsmData::transition_t &transition)
 {
-	int source_state;
-
-	do
-	{
-		source_state = std::rand() % fsm_data.state_table.size();
-	}
-	while (source_state == transition.state_out);
+	// TODO replace placeholder
+	return transition.ctrl_in.is_fully_def();
+}
 
-	transition.state_out = source_state;
+// A candidate bug redirects one challenging transition of one FSM to another state
+struct mutation_t {int fsm, transition, slot, state_out;};
+
+struct fsm_t {
+	RTLIL::Module *module;
+	RTLIL::Cell *cell;
+	FsmData fsm_data;
+	// Indices of the challenging transitions, the slot of a mutation indexes this list
+	std::vector<int> mutable_transitions;
+	int state_bits, slot_bits;
+};
+
+// Every value of the mutation select {slot, state} is one mutation: slot 0 leaves the FSM intact and
+// slot i+1 redirects the i-th challenging transition to the given state
+static RTLIL::Const mutation_select(const fsm_t &fsm, const mutation_t &mutation)
+{
+	RTLIL::Const select(mutation.state_out, fsm.state_bits);
+	RTLIL::Const slot(mutation.slot + 1, fsm.slot_bits);
+	select.bits.insert(select.bits.end(), slot.bits.begin(), slot.bits.end());
+	return select;
 }
 
-static bool is_challenging(FsmData::transition_t &transition)
+// Appends the mutation select to the control inputs. A challenging transition keeps its target
+// for all slots but its own, for its own slot the target is the selected state.
+static FsmData add_mutation_select(const fsm_t &fsm)
 {
-	// TODO replace placeholder
-	return transition.ctrl_in.is_fully_def();
+	FsmData gate_data = fsm.fsm_data;
+	int select_bits = fsm.state_bits + fsm.slot_bits;
+	gate_data.num_inputs += select_bits;
+	gate_data.transition_table.clear();
+
+	pool<int> mutable_transitions(fsm.mutable_transitions.begin(), fsm.mutable_transitions.end());
+	for (int i = 0; i < GetSize(fsm.fsm_data.transition_table); ++i) {
+		const FsmData::transition_t &transition = fsm.fsm_data.transition_table.at(i);
+		if (!mutable_transitions.count(i)) {
+			FsmData::transition_t tr = transition;
+			tr.ctrl_in.bits.resize(gate_data.num_inputs, RTLIL::State::Sa);
+			gate_data.transition_table.push_back(tr);
+		}
+	}
+
+	for (int slot = 0; slot < GetSize(fsm.mutable_transitions); ++slot) {
+		const FsmData::transition_t &transition = fsm.fsm_data.transition_table.at(fsm.mutable_transitions.at(slot));
+		RTLIL::Const slot_value(slot + 1, fsm.slot_bits);
+
+		// Disjoint cubes for slot != slot_value: the bits below b match, bit b differs
+		for (int b = 0; b < fsm.slot_bits; ++b) {
+			FsmData::transition_t tr = transition;
+			tr.ctrl_in.bits.resize(fsm.fsm_data.num_inputs + fsm.state_bits, RTLIL::State::Sa);
+			for (int j = 0; j < fsm.slot_bits; ++j)
+				tr.ctrl_in.bits.push_back(j < b ? slot_value.bits.at(j) : j == b ? (slot_value.bits.at(j) == RTLIL::State::S1 ? RTLIL::State::S0 : RTLIL::State::S1) : RTLIL::State::Sa);
+			gate_data.transition_table.push_back(tr);
+		}
+
+		for (int state = 0; state < GetSize(fsm.fsm_data.state_table); ++state) {
+			FsmData::transition_t tr = transition;
+			RTLIL::Const select = mutation_select(fsm, mutation_t{0, 0, slot, state});
+			tr.ctrl_in.bits.insert(tr.ctrl_in.bits.end(), select.bits.begin(), select.bits.end());
+			tr.state_out = state;
+			gate_data.transition_table.push_back(tr);
+		}
+	}
+
+	return gate_data;
 }
 
-static RTLIL::Design *create_miter(RTLIL::Module *module, RTLIL::Cell *cell, FsmData &fsm_data, FsmData::transition_t &transition, std::vector<std::string> &observables)
+static RTLIL::Design *create_miter(const fsm_t &fsm, std::vector<std::string> &observables, bool hierarchical)
 {
+	RTLIL::Module *module = fsm.module;
+	RTLIL::Cell *cell = fsm.cell;
 	RTLIL::Design *miter_design = new RTLIL::Design;
 
 	RTLIL::Module *miter_module = new RTLIL::Module;
 	miter_module->name = "\\miter_" + module->name.str().substr(1);
 	miter_design->add(miter_module);
 
+	// Submodules of a hierarchical miter are black boxes shared by the gold and the gate side
+	if (hierarchical)
+		for (auto submodule_cell : module->cells()) {
+			RTLIL::Module *submodule = module->design->module(submodule_cell->type);
+			if (!submodule || miter_design->module(submodule->name)) continue;
+			RTLIL::Module *black_box = submodule->clone();
+			black_box->makeblackbox();
+			miter_design->add(black_box);
+		}
+
 	// Setup gold module
 	RTLIL::Module *gold_module = module->clone();
 	gold_module->name = "\\gold_" + module->name.str().substr(1);
@@ -97,15 +164,20 @@ static RTLIL::Design *create_miter(RTLIL::Module *module, RTLIL::Cell *cell, Fsm
 	// gold_module->fixup_ports();
 	// gold_module->connect(RTLIL::SigSig(RTLIL::SigSpec(gold_state_wire), gold_sigmap(RTLIL::SigSpec(gold_state))));
 
-	// Setup gate module
+	// Setup gate module, which holds every mutation of the FSM behind the mutation select input
 	RTLIL::Module *gate_module = module->clone();
 	gate_module->name = "\\gate_" + module->name.str().substr(1);
 	miter_design->add(gate_module);
 
-	corrupt_transition(fsm_data, transition);
-	fsm_data.copy_to_cell(gate_module->cells_.at(cell->name));
+	RTLIL::Cell *gate_fsm = gate_module->cells_.at(cell->name);
+	RTLIL::SigSpec gate_input = gate_fsm->getPort(ID::CTRL_IN);
+
+	RTLIL::Wire *mutation_wire = gate_module->addWire("\\injection_mutation", fsm.state_bits + fsm.slot_bits);
+	mutation_wire->port_input = true;
+	gate_module->fixup_ports();
 
-	RTLIL::SigSpec gate_input = gate_module->cells_.at(cell->name)->getPort(ID::CTRL_IN);
+	add_mutation_select(fsm).copy_to_cell(gate_fsm);
+	gate_fsm->setPort(ID::CTRL_IN, RTLIL::SigSpec({mutation_wire, gate_input}));
 
 	Pass::call(miter_design, "fsm_map");
 
@@ -149,7 +221,9 @@ static RTLIL::Design *create_miter(RTLIL::Module *module, RTLIL::Cell *cell, Fsm
 			RTLIL::Wire *w = miter_module->addWire("\\in_" + RTLIL::unescape_id(gold_wire->name), gold_wire->width);
 			w->port_input = true;
 
-			gold_cell->setPort(gold_wire->name, w);
+			// The mutation select only exists on the gate side
+			if (gold_module->wire(gold_wire->name))
+				gold_cell->setPort(gold_wire->name, w);
 			gate_cell->setPort(gold_wire->name, w);
 		}
 
@@ -197,11 +271,65 @@ static RTLIL::Design *create_miter(RTLIL::Module *module, RTLIL::Cell *cell, Fsm
 	return miter_design;
 }
 
+static json11::Json result_to_json(int index, const fsm_t &fsm, const mutation_t &mutation, const verify_result_t &result)
+{
+	const FsmData::transition_t &transition = fsm.fsm_data.transition_table.at(mutation.transition);
+	return json11::Json::object{
+		{"mutation", index},
+		{"module", log_id(fsm.module)},
+		{"cell", log_id(fsm.cell)},
+		{"transition", mutation.transition},
+		{"state_in", transition.state_in},
+		{"original_state_out", transition.state_out},
+		{"state_out", mutation.state_out},
+		{"status", result.status},
+		{"sensitization_step", result.sensitization_step},
+		{"propagation_step", result.propagation_step},
+	};
+}
+
 struct InjectFsmPass : public Pass {
 	InjectFsmPass() : Pass("inject_fsm", "inject bugs into the FSMs") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    inject_fsm [options] [selection]\n");
+		log("\n");
+		log("This pass extracts the FSMs of the selected modules and checks for every\n");
+		log("challenging transition and every other target state whether redirecting the\n");
+		log("transition is observable. All mutations of one FSM share one miter: the gate\n");
+		log("side holds every mutation behind a free mutation select input, so the miter is\n");
+		log("synthesized once per FSM and every mutation is a single assumption on one\n");
+		log("incremental SAT solver.\n");
+		log("\n");
+		log("Options:\n");
+		log("\n");
+		log("    -j workers\n");
+		log("        split the mutations into contiguous ranges that are checked by the\n");
+		log("        given number of worker processes. The results are logged in the\n");
+		log("        order of the mutations independent of the number of workers.\n");
+		log("    -results file\n");
+		log("        also keep the results as one JSON object per line in the given file\n");
+		log("    -observable signal\n");
+		log("        a signal of the module that makes the mutation observable\n");
+		log("    -maxsteps steps\n");
+		log("        the maximum depth of the sensitization and propagation checks\n");
+		log("    -timeout seconds\n");
+		log("        the timeout of every SAT call\n");
+		log("    -set <signal> <value>\n");
+		log("    -set-at <timestep> <signal> <value>\n");
+		log("    -unset-at <timestep> <signal>\n");
+		log("    -set-init <signal> <value>\n");
+		log("    -set-init-zero\n");
+		log("        constraints on the miter, see sat\n");
+		log("    -show-inputs\n");
+		log("    -show-outputs\n");
+		log("        print the inputs and outputs of the miter for every solution\n");
+		log("    -hierarchical\n");
+		log("        the submodules of the FSM module become black boxes shared by both\n");
+		log("        sides of the miter\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -210,13 +338,22 @@ struct InjectFsmPass : public Pass {
 		std::map<int, std::vector<std::string>> unsets_at;
 		std::vector<std::string> shows;
 		std::vector<std::string> observables;
-		int maxsteps = 24, initsteps = 0, timeout = 0, stepsize = 1;
-		bool set_init_zero = false, show_inputs = false, show_outputs = false;
+		std::string results_filename;
+		int maxsteps = 24, initsteps = 0, timeout = 0, stepsize = 1, num_workers = 1;
+		bool set_init_zero = false, show_inputs = false, show_outputs = false, hierarchical = false;
 
 		log_header(design, "Executing InjectFSM pass.\n");
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_workers = max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-results" && argidx+1 < args.size()) {
+				results_filename = args[++argidx];
+				continue;
+			}
 			if (args[argidx] == "-timeout" && argidx+1 < args.size()) {
 				timeout = atoi(args[++argidx].c_str());
 				continue;
@@ -277,7 +414,13 @@ struct InjectFsmPass : public Pass {
 				observables.push_back(args[++argidx]);
 				continue;
 			}
+			if (args[argidx] == "-hierarchical") {
+				hierarchical = true;
+				continue;
+			}
+			break;
 		}
+		extra_args(args, argidx, design);
 
 		// TODO expand FSMs
 		// Pass::call(design, "fsm_detect -ignore-good-state-reg -ignore-init-attr -ignore-module-port -ignore-self-reset");
@@ -295,112 +438,166 @@ struct InjectFsmPass : public Pass {
 		// Pass::call(design, "fsm_opt");
 		// Pass::call(design, "fsm_info");
 
+		// Enumerate the mutations in a fixed order, the results are merged in this order
+		std::vector<fsm_t> fsms;
+		std::vector<mutation_t> mutations;
 		for (auto module : design->selected_modules()) {
 			for (auto cell : module->selected_cells()) {
 				if (cell->type == ID($fsm)) {
-					FsmData fsm_data;
-					fsm_data.copy_from_cell(cell);
-
-					for (auto &transition : fsm_data.transition_table){
-						if(is_challenging(transition)){
-							FsmData::transition_t transition_copy = transition;
-
-							RTLIL::Design *miter_design = create_miter(module, cell, fsm_data, transition, observables);
-							RTLIL::Module *miter_mod = miter_design->module("\\miter_" + module->name.str().substr(1));
-
-							shows.clear();
-							if (show_inputs) {
-								for (auto &it : miter_mod->wires_)
-									if (it.second->port_input)
-										shows.push_back(it.second->name.str());
-							}
-							if (show_outputs) {
-								for (auto &it : miter_mod->wires_)
-									if (it.second->port_output)
-										shows.push_back(it.second->name.str());
-							}
-
-							// TODO check out enable undef (speedup?)
-							SatHelper sathelper(miter_design, miter_mod, false, false);
-							sathelper.sets = sets;
-							sathelper.sets_at = sets_at;
-							sathelper.unsets_at = unsets_at;
-							sathelper.shows = shows;
-							sathelper.timeout = timeout;
-							sathelper.sets_init = sets_init;
-							sathelper.set_init_zero = set_init_zero;
-
-							RTLIL::SigSpec fsm_lhs, fsm_rhs;
-
-							RTLIL::Wire *state_wire = miter_mod->wire("\\gate_injection_state");
-							if (!state_wire) log_cmd_error("State port is missing!\n");
-							fsm_lhs.append(state_wire);
-							fsm_rhs.append(fsm_data.state_table.at(transition.state_in));
-							if (fsm_lhs.size() != fsm_rhs.size())
-								log_cmd_error("State expression with different lhs and rhs sizes.\n");
-
-							RTLIL::Wire *input_wire = miter_mod->wire("\\gate_injection_input");
-							if (!input_wire) log_cmd_error("Input port is missing!\n");
-							fsm_lhs.append(input_wire);
-							fsm_rhs.append(transition.ctrl_in);
-							if (fsm_lhs.size() != fsm_rhs.size())
-								log_cmd_error("Input expression with different lhs and rhs sizes.\n");
-
-							for(int sensitization_step = 1; sensitization_step <= maxsteps; sensitization_step++){
-								log("Sensitizing.\n");
-								sathelper.setup(sensitization_step, sensitization_step == 1);
-								sathelper.generate_model();
-								log_flush();
-
-								if (sathelper.solve(sathelper.satgen.signals_eq(fsm_lhs, fsm_rhs, sensitization_step))){
-									log("Sensitized the bug.\n");
-									sathelper.print_model();
-									log_flush();
-									
-									std::vector<int> clause;
-
-									// TODO possibly wrong check invalidate_model
-									for (size_t i = 0; i < sathelper.modelExpressions.size(); i++)
-										clause.push_back(sathelper.modelValues.at(i) ? sathelper.modelExpressions.at(i) : sathelper.ez->NOT(sathelper.modelExpressions.at(i)));
-									sathelper.ez->assume(sathelper.ez->expression(ezSAT::OpAnd, clause));
-
-									RTLIL::Wire *gold_observables_wire = miter_mod->wire("\\gold_injection_observables");
-									if (!gold_observables_wire) log_cmd_error("Gold observables port is missing!\n");
-									RTLIL::Wire *gate_observables_wire = miter_mod->wire("\\gate_injection_observables");
-									if (!gate_observables_wire) log_cmd_error("Gate observables port is missing!\n");
-									RTLIL::SigSpec observables_lhs(gold_observables_wire), observables_rhs(gate_observables_wire);
-									if (observables_lhs.size() != observables_rhs.size())
-										log_cmd_error("Observables expression with different lhs and rhs sizes.\n");
-
-									for(int propagation_step = sensitization_step + 1; propagation_step <= maxsteps; ++propagation_step){
-										log("Propagating.\n");
-										sathelper.setup(propagation_step, propagation_step == 1);
-										sathelper.generate_model();
-										log_flush();
-
-										if(sathelper.solve(sathelper.ez->NOT(sathelper.satgen.signals_eq(observables_lhs, observables_rhs, propagation_step)))){
-											log("Propagated the bug.\n");
-											sathelper.print_model();
-											goto found_pov;
-										}
-									}
-								}
-							}
-
-							transition = transition_copy;
-							found_pov:
-							;
-							// TODO check whether deleting this is necessary because it causes problems
-							// delete miter_design;
-							break;
-						}
+					fsm_t fsm;
+					fsm.module = module;
+					fsm.cell = cell;
+					fsm.fsm_data.copy_from_cell(cell);
+					int num_states = GetSize(fsm.fsm_data.state_table);
+					for (int i = 0; i < GetSize(fsm.fsm_data.transition_table); ++i) {
+						const FsmData::transition_t &transition = fsm.fsm_data.transition_table.at(i);
+						if (!is_challenging(transition)) continue;
+						int slot = GetSize(fsm.mutable_transitions);
+						fsm.mutable_transitions.push_back(i);
+						for (int state = 0; state < num_states; ++state)
+							if (state != transition.state_out)
+								mutations.push_back(mutation_t{GetSize(fsms), i, slot, state});
 					}
-					// TODO bugs interfere with each other due to the loose placeholder is challenging condition
-					// uncomment later
-					// fsm_data.copy_to_cell(cell);
+					fsm.state_bits = max(1, ceil_log2(num_states));
+					fsm.slot_bits = max(1, ceil_log2(GetSize(fsm.mutable_transitions) + 1));
+					fsms.push_back(fsm);
 				}
 			}
 		}
+
+		std::string output_filename = results_filename.empty() ? make_temp_file() : results_filename;
+		FILE *results_file = fopen(output_filename.c_str(), "w");
+		if (!results_file)
+			log_cmd_error("Can't open results file `%s' for writing: %s\n", output_filename.c_str(), strerror(errno));
+		fclose(results_file);
+
+		num_workers = max(1, min(num_workers, GetSize(mutations)));
+		log("Checking %d mutations of %d FSMs with %d worker%s.\n", GetSize(mutations), GetSize(fsms), num_workers, num_workers == 1 ? "" : "s");
+
+		int num_failed = run_workers(num_workers, [&](int worker) {
+			int first_index = GetSize(mutations) * worker / num_workers;
+			int last_index = GetSize(mutations) * (worker + 1) / num_workers;
+
+			// Every line is written and flushed on its own, appends of different workers never mix
+			FILE *f = fopen(output_filename.c_str(), "a");
+			if (!f)
+				log_error("Can't open results file `%s' for appending: %s\n", output_filename.c_str(), strerror(errno));
+
+			for (int i = first_index; i < last_index; ) {
+				const fsm_t &fsm = fsms.at(mutations.at(i).fsm);
+				RTLIL::Design *miter_design = create_miter(fsm, observables, hierarchical);
+				{
+					RTLIL::Module *miter_mod = miter_design->module("\\miter_" + fsm.module->name.str().substr(1));
+					std::vector<black_box_t> black_boxes;
+					if (hierarchical)
+						black_boxes = abstract_black_boxes(miter_design, miter_mod);
+
+					shows.clear();
+					if (show_inputs) {
+						for (auto &it : miter_mod->wires_)
+							if (it.second->port_input)
+								shows.push_back(it.second->name.str());
+					}
+					if (show_outputs) {
+						for (auto &it : miter_mod->wires_)
+							if (it.second->port_output)
+								shows.push_back(it.second->name.str());
+					}
+
+					// TODO check out enable undef (speedup?)
+					SatHelper sathelper(miter_design, miter_mod, false, false);
+					sathelper.sets = sets;
+					sathelper.sets_at = sets_at;
+					sathelper.unsets_at = unsets_at;
+					sathelper.shows = shows;
+					sathelper.timeout = timeout;
+					sathelper.sets_init = sets_init;
+					sathelper.set_init_zero = set_init_zero;
+
+					RTLIL::Wire *mutation_wire = miter_mod->wire("\\in_injection_mutation");
+					if (!mutation_wire) log_cmd_error("Mutation port is missing!\n");
+					RTLIL::Wire *state_wire = miter_mod->wire("\\gate_injection_state");
+					if (!state_wire) log_cmd_error("State port is missing!\n");
+					RTLIL::Wire *input_wire = miter_mod->wire("\\gate_injection_input");
+					if (!input_wire) log_cmd_error("Input port is missing!\n");
+					RTLIL::Wire *gold_observables_wire = miter_mod->wire("\\gold_injection_observables");
+					if (!gold_observables_wire) log_cmd_error("Gold observables port is missing!\n");
+					RTLIL::Wire *gate_observables_wire = miter_mod->wire("\\gate_injection_observables");
+					if (!gate_observables_wire) log_cmd_error("Gate observables port is missing!\n");
+
+					BugVerifier verifier(sathelper, maxsteps, maxsteps);
+					verifier.black_boxes = black_boxes;
+
+					for (; i < last_index && &fsms.at(mutations.at(i).fsm) == &fsm; ++i) {
+						const mutation_t &mutation = mutations.at(i);
+						const FsmData::transition_t &transition = fsm.fsm_data.transition_table.at(mutation.transition);
+						log("\nChecking mutation %d: transition %d of %s from state %d to state %d instead of %d.\n", i, mutation.transition,
+								log_id(fsm.cell), transition.state_in, mutation.state_out, transition.state_out);
+
+						RTLIL::SigSpec fsm_lhs, fsm_rhs;
+						fsm_lhs.append(state_wire);
+						fsm_rhs.append(fsm.fsm_data.state_table.at(transition.state_in));
+						if (fsm_lhs.size() != fsm_rhs.size())
+							log_cmd_error("State expression with different lhs and rhs sizes.\n");
+						fsm_lhs.append(input_wire);
+						fsm_rhs.append(transition.ctrl_in);
+						if (fsm_lhs.size() != fsm_rhs.size())
+							log_cmd_error("Input expression with different lhs and rhs sizes.\n");
+
+						// The mutation select input is free, so it is fixed at every time step
+						std::vector<int> mutation_literals;
+						for (int step = 1; step <= maxsteps; ++step)
+							mutation_literals.push_back(sathelper.satgen.signals_eq(mutation_wire, mutation_select(fsm, mutation), step));
+						std::vector<int> assumptions = {sathelper.ez->expression(ezSAT::OpAnd, mutation_literals)};
+
+						verify_result_t result = verifier.verify([&](int step) {
+							return sathelper.satgen.signals_eq(fsm_lhs, fsm_rhs, step);
+						}, [&](int step) {
+							return sathelper.ez->NOT(sathelper.satgen.signals_eq(gold_observables_wire, gate_observables_wire, step));
+						}, assumptions);
+
+						std::string line = result_to_json(i, fsm, mutation, result).dump() + "\n";
+						fputs(line.c_str(), f);
+						fflush(f);
+					}
+				}
+				delete miter_design;
+			}
+			fclose(f);
+		});
+		if (num_failed)
+			log_error("%d of %d workers failed.\n", num_failed, num_workers);
+
+		// Merge the results of the workers in the order of the mutations
+		std::vector<json11::Json> results(GetSize(mutations));
+		int num_results = 0;
+		std::ifstream results_stream(output_filename);
+		for (std::string line; std::getline(results_stream, line); ) {
+			std::string err;
+			json11::Json result = json11::Json::parse(line, err);
+			if (!err.empty()) continue;
+			int index = result["mutation"].int_value();
+			if (index < 0 || index >= GetSize(results) || !results.at(index).is_null()) continue;
+			results.at(index) = result;
+			num_results++;
+		}
+		results_stream.close();
+		if (results_filename.empty())
+			remove(output_filename.c_str());
+
+		log("\nFSM mutation results:\n");
+		for (int i = 0; i < GetSize(results); ++i) {
+			const json11::Json &result = results.at(i);
+			if (result.is_null()) continue;
+			log("  %s transition %d, state %d -> %d (was %d): %s", result["cell"].string_value().c_str(), result["transition"].int_value(),
+					result["state_in"].int_value(), result["state_out"].int_value(), result["original_state_out"].int_value(), result["status"].string_value().c_str());
+			if (result["sensitization_step"].int_value()) log(", sensitized at step %d", result["sensitization_step"].int_value());
+			if (result["propagation_step"].int_value()) log(", propagated at step %d", result["propagation_step"].int_value());
+			log("\n");
+		}
+		if (num_results != GetSize(mutations))
+			log_warning("Expected %d results, got %d.\n", GetSize(mutations), num_results);
+
 		log("Done injecting!\n");
 		Pass::call(design, "fsm_info");
 		Pass::call(design, "fsm_map");
@@ -30,41 +30,13 @@
 #include <errno.h>
 #include <string.h>
 #include "selection.h"
-#include <chrono>
+#include "simulate.h"
+#include "verify.h"
+#include "result_cache.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-static std::string get_time(){
-	auto now = std::chrono::system_clock::now();
-	auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-	std::time_t now_time_t = std::chrono::system_clock::to_time_t(now);
-	char buf[100];
-    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", std::localtime(&now_time_t));
-
-	return std::string(buf)+"."+std::to_string(milliseconds.count());
-}
-
-static void synthetize_miter(RTLIL::Design *design, std::string top_module)
-{
-	Pass::call(design, "inject_map");
-	Pass::call(design, "opt");
-	Pass::call(design, "hierarchy -check -top " + top_module);
-	Pass::call(design, "flatten");
-	Pass::call(design, "opt");
-	Pass::call(design, "wreduce");
-	Pass::call(design, "peepopt");
-	Pass::call(design, "opt_clean");
-	// TODO check whether this can be removed
-	Pass::call(design, "memory -nomap");
-	Pass::call(design, "opt_clean");
-	Pass::call(design, "opt -fast -full");
-	Pass::call(design, "memory_map");
-	Pass::call(design, "opt -full");
-	Pass::call(design, "clk2fflogic");
-	Pass::call(design, "opt -full -fine");
-}
-
 // TODO take care of inconsistent naming cell/amt
 static RTLIL::Module *create_miter(RTLIL::Design *design, RTLIL::Module *host_module, RTLIL::Cell *host_amt, RTLIL::Module *reference_module, RTLIL::Cell *reference_amt, std::vector<std::string> &observables)
 {
@@ -156,11 +128,236 @@ static RTLIL::Module *create_miter(RTLIL::Design *design, RTLIL::Module *host_mo
 	return miter_module;
 }
 
+// Returns the same signal in a copy of the module
+static RTLIL::SigSpec remap_sig(RTLIL::Module *module, const RTLIL::SigSpec &sig)
+{
+	RTLIL::SigSpec result;
+	for (auto bit : sig.bits())
+		result.append(bit.wire ? RTLIL::SigBit(module->wire(bit.wire->name), bit.offset) : bit);
+	return result;
+}
+
+// Random simulation of the miter before any SAT call. Bugs that most stimuli trigger are found
+// here with a concrete trace, and only the remaining ones have to be unrolled into the solver.
+static verify_result_t simulate_miter(RTLIL::Module *miter_module, const std::vector<RTLIL::SigSig> &selects, const std::vector<std::pair<std::string, std::string>> &sets,
+		bool set_init_zero, int rounds, int max_sensitization, int max_propagation, Witness *witness)
+{
+	verify_result_t result;
+	result.status = "unsat";
+
+	RTLIL::Design *sim_design = new RTLIL::Design;
+	RTLIL::Module *sim_module = miter_module->clone();
+	sim_design->add(sim_module);
+	Pass::call(sim_design, "techmap");
+
+	BitSimulator sim(sim_module);
+	if (!sim.unsupported.empty()) {
+		log("Skipping simulation, can not simulate %s.\n", sim.unsupported.c_str());
+		delete sim_design;
+		return result;
+	}
+
+	// Only constant inputs can be honored, anything else is left to the solver
+	dict<RTLIL::SigBit, RTLIL::State> fixed;
+	for (auto &set : sets) {
+		RTLIL::SigSpec lhs, rhs;
+		if (!RTLIL::SigSpec::parse_sel(lhs, sim_design, sim_module, set.first) || !RTLIL::SigSpec::parse_rhs(lhs, rhs, sim_module, set.second) || !rhs.is_fully_const()) {
+			log("Skipping simulation, can not apply -set %s %s.\n", set.first.c_str(), set.second.c_str());
+			delete sim_design;
+			return result;
+		}
+		for (int i = 0; i < GetSize(lhs); ++i) {
+			if (!lhs[i].wire || !lhs[i].wire->port_input) {
+				log("Skipping simulation, -set %s is not an input.\n", set.first.c_str());
+				delete sim_design;
+				return result;
+			}
+			fixed[lhs[i]] = rhs[i].data;
+		}
+	}
+
+	std::vector<RTLIL::SigBit> inputs;
+	for (auto wire : sim_module->wires())
+		if (wire->port_input)
+			for (int i = 0; i < wire->width; ++i)
+				inputs.push_back(RTLIL::SigBit(wire, i));
+
+	std::vector<RTLIL::SigSig> sim_selects;
+	for (auto &select : selects)
+		sim_selects.push_back(RTLIL::SigSig(remap_sig(sim_module, select.first), select.second));
+	RTLIL::SigSpec host_output = sim_module->wire("\\host_output"), reference_output = sim_module->wire("\\reference_output");
+	RTLIL::SigSpec host_observables = sim_module->wire("\\host_observables"), reference_observables = sim_module->wire("\\reference_observables");
+
+	// The witness is recorded on the miter, which has the same wire names as the simulated copy
+	dict<RTLIL::SigBit, int> input_index;
+	for (int i = 0; i < GetSize(inputs); ++i)
+		input_index[inputs[i]] = i;
+	if (witness)
+		for (auto &signal : witness->signals)
+			sim.slot(remap_sig(sim_module, signal.chunk));
+
+	log("Simulating %d rounds of %d random traces with %d cycles.\n", rounds, sim_lanes, max_propagation);
+	std::mt19937_64 rng(1);
+	for (int round = 0; round < rounds; ++round) {
+		sim.init_state(rng, set_init_zero);
+		std::vector<sim_word_t> initial_values = sim.values;
+		sim_word_t sensitized = {};
+		std::vector<int> sensitization_steps(sim_lanes);
+		std::vector<std::vector<sim_word_t>> history;
+
+		for (int step = 1; step <= max_propagation; ++step) {
+			history.push_back(std::vector<sim_word_t>());
+			for (auto bit : inputs) {
+				sim_word_t &word = sim.value(bit);
+				for (auto &w : word)
+					w = fixed.count(bit) ? (fixed.at(bit) == RTLIL::State::S1 ? ~uint64_t(0) : 0) : rng();
+				history.back().push_back(word);
+			}
+			sim.eval();
+
+			// Propagation has to happen after the sensitizing step, as in the SAT check
+			sim_word_t propagated = sim.differ(host_observables, reference_observables);
+			for (int j = 0; j < sim_words; ++j)
+				propagated[j] &= sensitized[j];
+
+			if (step <= max_sensitization) {
+				sim_word_t selected = {};
+				for (auto &select : sim_selects) {
+					sim_word_t equal = sim.equal(select.first, select.second.as_const());
+					for (int j = 0; j < sim_words; ++j)
+						selected[j] |= equal[j];
+				}
+				sim_word_t differs = sim.differ(host_output, reference_output);
+				for (int lane = 0; lane < sim_lanes; ++lane)
+					if (!BitSimulator::lane(sensitized, lane) && BitSimulator::lane(selected, lane) && BitSimulator::lane(differs, lane))
+						sensitization_steps[lane] = step;
+				for (int j = 0; j < sim_words; ++j)
+					sensitized[j] |= selected[j] & differs[j];
+			}
+
+			for (int lane = 0; lane < sim_lanes; ++lane) {
+				if (!BitSimulator::lane(propagated, lane)) continue;
+
+				log("Simulation propagated the bug in round %d, trace %d:\n", round + 1, lane);
+				for (int t = 0; t < step; ++t) {
+					RTLIL::Wire *wire = nullptr;
+					RTLIL::Const value;
+					for (int i = 0; i <= GetSize(inputs); ++i) {
+						if (i == GetSize(inputs) || inputs[i].wire != wire) {
+							if (wire) log("  %4d %-40s %s\n", t + 1, log_id(wire), value.as_string().c_str());
+							if (i == GetSize(inputs)) break;
+							wire = inputs[i].wire;
+							value = RTLIL::Const();
+						}
+						value.bits.push_back(BitSimulator::lane(history[t][i], lane) ? RTLIL::State::S1 : RTLIL::State::S0);
+					}
+				}
+				if (witness) {
+					witness->steps.clear();
+					for (int t = 0; t < step; ++t) {
+						witness->steps.push_back(std::vector<RTLIL::Const>());
+						for (auto &signal : witness->signals) {
+							RTLIL::SigSpec sig = remap_sig(sim_module, signal.chunk);
+							RTLIL::Const value(RTLIL::State::Sa, GetSize(sig));
+							for (int i = 0; i < GetSize(sig); ++i) {
+								if (!signal.init_only)
+									value.bits[i] = BitSimulator::lane(history[t][input_index.at(sig[i])], lane) ? RTLIL::State::S1 : RTLIL::State::S0;
+								else if (t == 0)
+									value.bits[i] = BitSimulator::lane(initial_values[sim.slot(sig[i])], lane) ? RTLIL::State::S1 : RTLIL::State::S0;
+							}
+							witness->steps.back().push_back(value);
+						}
+					}
+				}
+				result.status = "propagated";
+				result.sensitization_step = sensitization_steps[lane];
+				result.propagation_step = step;
+				delete sim_design;
+				return result;
+			}
+			sim.clock();
+		}
+	}
+
+	log("Simulation did not propagate the bug.\n");
+	delete sim_design;
+	return result;
+}
+
 struct InjectVerifyPass : public Pass {
 	InjectVerifyPass() : Pass("inject_verify", "inject bugs into the AMTs") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    inject_verify [options]\n");
+		log("\n");
+		log("This pass checks whether the bug in the host module of the current design can\n");
+		log("be observed. The current design has to contain a buggy copy of the design in\n");
+		log("the module host and the original design in the module reference, the AMT cell\n");
+		log("of the bug is marked with the buggy attribute. Both are combined into a miter\n");
+		log("that is first simulated with random inputs and then checked by an incremental\n");
+		log("SAT solver: the bug is sensitized when a buggy selection of the AMT cell\n");
+		log("changes its output and propagated when the observables differ afterwards.\n");
+		log("\n");
+		log("Options:\n");
+		log("\n");
+		log("    -observable signal\n");
+		log("        a signal of the design that makes the bug observable\n");
+		log("    -max-sensitization steps\n");
+		log("    -max-propagation steps\n");
+		log("        the maximum depth of the sensitization and propagation checks,\n");
+		log("        20 and 32 by default\n");
+		log("    -timeout seconds\n");
+		log("        the timeout of every SAT call\n");
+		log("    -set <signal> <value>\n");
+		log("    -set-at <timestep> <signal> <value>\n");
+		log("    -unset-at <timestep> <signal>\n");
+		log("    -set-init <signal> <value>\n");
+		log("    -set-init-zero\n");
+		log("        constraints on the miter, see sat\n");
+		log("    -show-inputs\n");
+		log("    -show-outputs\n");
+		log("        print the inputs and outputs of the miter for every solution\n");
+		log("    -initsteps steps\n");
+		log("    -stepsize steps\n");
+		log("    -show <signal>\n");
+		log("        accepted for compatibility with sat and ignored, the checks always\n");
+		log("        start at the first step and advance one step at a time\n");
+		log("    -sim-rounds rounds\n");
+		log("        the number of rounds of the random simulation before the SAT check,\n");
+		log("        4 by default. Every round simulates 256 random traces in parallel. A\n");
+		log("        bug that propagates in simulation is reported without calling the\n");
+		log("        solver, otherwise the SAT check runs as usual. The simulation is\n");
+		log("        skipped with -hierarchical, -set-at, -unset-at and -set-init, and\n");
+		log("        when a -set constraint does not fix an input to a constant.\n");
+		log("    -no-sim\n");
+		log("        skip the random simulation, same as -sim-rounds 0\n");
+		log("    -witness file\n");
+		log("        write the sensitizing and propagating trace of the bug to the given\n");
+		log("        file in the Yosys witness format, so that sim -r can replay it on the\n");
+		log("        miter. The inputs are recorded at every step, the flip-flop state only\n");
+		log("        at the first one. No file is written for an unobservable bug.\n");
+		log("    -share\n");
+		log("        merge structurally identical logic of the host and reference sides,\n");
+		log("        this assumes that both sides start in the same state. Flip-flops\n");
+		log("        with undefined init bits are only merged with -set-init-zero.\n");
+		log("    -hierarchical\n");
+		log("        only flatten the modules that contain the buggy module, all other\n");
+		log("        modules become black boxes shared by both sides of the miter. This\n");
+		log("        over-approximates the design, so \"unsat\" results are conclusive\n");
+		log("        and propagations may be spurious.\n");
+		log("    -coi\n");
+		log("        remove all logic outside the sequential fan-in of the miter outputs,\n");
+		log("        the constraint signals and the keep wires and cells before unrolling\n");
+		log("    -cache directory\n");
+		log("        look up the result in the given cache directory before verifying the\n");
+		log("        bug and store it there afterwards. The key is a structural hash of the\n");
+		log("        logic in the cone of the miter outputs and the options that change the\n");
+		log("        result, so bugs of other campaigns with the same cone share a result.\n");
+		log("        Timeouts are not cached. The directory may be shared by concurrent\n");
+		log("        processes.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -170,6 +367,9 @@ struct InjectVerifyPass : public Pass {
 		std::vector<std::string> shows;
 		std::vector<std::string> observables;
 		int max_sensitization = 20, max_propagation = 32, initsteps = 0, timeout = 0, stepsize = 1;
+		int sim_rounds = 4;
+		bool share = false, hierarchical = false, coi = false;
+		std::string witness_filename, cache_directory;
 		bool set_init_zero = false, show_inputs = false, show_outputs = false;
 
 		log_header(design, "Executing InjectVerify pass.\n");
@@ -240,6 +440,34 @@ struct InjectVerifyPass : public Pass {
 				observables.push_back(args[++argidx]);
 				continue;
 			}
+			if (args[argidx] == "-sim-rounds" && argidx+1 < args.size()) {
+				sim_rounds = max(0, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-share") {
+				share = true;
+				continue;
+			}
+			if (args[argidx] == "-hierarchical") {
+				hierarchical = true;
+				continue;
+			}
+			if (args[argidx] == "-coi") {
+				coi = true;
+				continue;
+			}
+			if (args[argidx] == "-no-sim") {
+				sim_rounds = 0;
+				continue;
+			}
+			if (args[argidx] == "-witness" && argidx+1 < args.size()) {
+				witness_filename = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-cache" && argidx+1 < args.size()) {
+				cache_directory = args[++argidx];
+				continue;
+			}
 		}
 
         RTLIL::Module *host_module = design->module("\\host");
@@ -279,7 +507,28 @@ struct InjectVerifyPass : public Pass {
 		}
 
         RTLIL::Module *miter_module = create_miter(design, host_module, host_cell, reference_module, reference_cell, observables);
-        synthetize_miter(design, miter_module->name.str());
+		pool<RTLIL::IdString> bug_modules;
+		if (hierarchical)
+			bug_modules = {host_module->name, reference_module->name};
+        synthetize_miter(design, miter_module->name.str(), bug_modules);
+		if (coi) {
+			std::vector<std::string> constraints;
+			for (auto &set : sets)
+				constraints.insert(constraints.end(), {set.first, set.second});
+			for (auto &it : sets_at)
+				for (auto &set : it.second)
+					constraints.insert(constraints.end(), {set.first, set.second});
+			for (auto &it : unsets_at)
+				constraints.insert(constraints.end(), it.second.begin(), it.second.end());
+			for (auto &set : sets_init)
+				constraints.insert(constraints.end(), {set.first, set.second});
+			reduce_miter(design, miter_module, constraints);
+		}
+		if (share)
+			share_miter(design, miter_module, set_init_zero);
+		std::vector<black_box_t> black_boxes;
+		if (hierarchical)
+			black_boxes = abstract_black_boxes(design, miter_module);
 
 
 
@@ -341,75 +590,83 @@ struct InjectVerifyPass : public Pass {
         if (host_observables.size() != reference_observables.size())
             log_cmd_error("Observables expression with different lhs and rhs sizes.\n");
 
-		log("Sensitizing the bug!\n");
-		log("time: %s\n", get_time().c_str());
-		log_flush();
-        for(int sensitization_step = 1; sensitization_step <= max_sensitization; sensitization_step++){
-            sathelper.setup(sensitization_step, sensitization_step == 1);
-            sathelper.generate_model();
-            log_flush();
-
-            // TODO maybe implement steps of size > 1
+		Witness witness(miter_module);
+
+		// Structurally identical bugs with the same setup, e.g. of an earlier campaign, have the same result
+		std::string key;
+		if (!cache_directory.empty()) {
+			std::vector<std::pair<std::string, RTLIL::SigSpec>> roots;
+			std::string setup = stringf("inject_verify %d %d %d %d", max_sensitization, max_propagation, share, hierarchical);
+			setup += describe_constraints(sets, sets_at, unsets_at, sets_init, set_init_zero);
+			for (auto &select : selects) {
+				roots.push_back(std::make_pair("select", select.first));
+				setup += " select=" + select.second.as_const().as_string();
+			}
+			for (auto &black_box : black_boxes)
+				for (int side = 0; side < 2; ++side) {
+					roots.push_back(std::make_pair("black box inputs", black_box.inputs[side]));
+					roots.push_back(std::make_pair("black box outputs", black_box.outputs[side]));
+				}
+			key = cache_key(miter_module, roots, setup);
+
+			json11::Json entry;
+			if (cache_lookup(cache_directory, key, entry)) {
+				// A witness can only be reused for the same witness signals
+				bool witness_usable = witness_filename.empty() || entry["status"].string_value() == "unsat" ||
+						(entry["witness"].is_object() && entry["witness"]["signals"] == witness.to_json()["signals"]);
+				if (witness_usable) {
+					log_cached_result(key, entry);
+					if (!witness_filename.empty() && entry["witness"].is_object())
+						write_witness(witness_filename, entry["witness"]);
+					return;
+				}
+			}
+		}
+		auto store_result = [&](const verify_result_t &result) {
+			if (key.empty() || result.status == "timeout")
+				return;
+			json11::Json::object entry{
+				{"status", result.status},
+				{"sensitization_step", result.sensitization_step},
+				{"propagation_step", result.propagation_step},
+			};
+			if (!witness.steps.empty())
+				entry["witness"] = witness.to_json();
+			cache_store(cache_directory, key, entry);
+		};
+
+		// The simulator can not evaluate black boxes
+		if (sim_rounds && !hierarchical && sets_init.empty() && sets_at.empty() && unsets_at.empty()) {
+			verify_result_t simulated = simulate_miter(miter_module, selects, sets, set_init_zero, sim_rounds, max_sensitization, max_propagation,
+					witness_filename.empty() ? nullptr : &witness);
+			if (simulated.status == "propagated") {
+				log("Sensitized the bug.\n");
+				log("Propagated the bug.\n");
+				log("time: %s\n", get_time().c_str());
+				if (!witness_filename.empty())
+					witness.write(witness_filename);
+				store_result(simulated);
+				return;
+			}
+		}
 
+		BugVerifier verifier(sathelper, max_sensitization, max_propagation);
+		verifier.black_boxes = black_boxes;
+		if (!witness_filename.empty())
+			verifier.witness = &witness;
+		verify_result_t result = verifier.verify([&](int step) {
 			// TODO maybe check whether this could be done in a smarter way
 			std::vector<int> clause;
 			for (auto select : selects) {
-				clause.push_back(sathelper.satgen.signals_eq(select.first, select.second, sensitization_step));
+				clause.push_back(sathelper.satgen.signals_eq(select.first, select.second, step));
 			}
-
-            // if (sathelper.solve(sathelper.ez->expression(ezSAT::OpOr, clause))){
-            if (sathelper.solve(sathelper.ez->AND(sathelper.ez->expression(ezSAT::OpOr, clause), sathelper.ez->NOT(sathelper.satgen.signals_eq(host_output, reference_output, sensitization_step))))){
-                // sathelper.ez->assume(sathelper.ez->AND(sathelper.satgen.signals_eq(select_circuit, select_selection, sensitization_step), sathelper.ez->NOT(sathelper.satgen.signals_eq(output_lhs, output_rhs, sensitization_step))));
-                // sathelper.maximize_undefs();
-
-                log("Sensitized the bug.\n");
-				log("time: %s\n", get_time().c_str());
-                log_flush();
-                sathelper.print_model();
-                log_flush();
-
-                // TODO possibly wrong check invalidate_model
-                // TODO check whether this also sets dont cares!!!!
-                for (size_t i = 0; i < sathelper.modelExpressions.size(); i++)
-                    sathelper.ez->assume(sathelper.modelValues.at(i) ? sathelper.modelExpressions.at(i) : sathelper.ez->NOT(sathelper.modelExpressions.at(i)));
-
-
-                for(int propagation_step = sensitization_step + 1; propagation_step <= max_propagation; ++propagation_step){
-                    sathelper.setup(propagation_step, propagation_step == 1);
-                    sathelper.generate_model();
-                    log_flush();
-
-                    // TODO maybe implement steps of size > 1
-
-                    // TODO beter logs
-                    if(sathelper.solve(sathelper.ez->NOT(sathelper.satgen.signals_eq(host_observables, reference_observables, propagation_step)))){
-                        log("Propagated the bug.\n");
-						log("time: %s\n", get_time().c_str());
-						log_flush();
-                        sathelper.print_model();
-                        log_flush();
-                        break;
-                    } else if (sathelper.gotTimeout) {
-                        log("Timed out.\n");
-						log("time: %s\n", get_time().c_str());
-                        log_flush();
-                        break;
-                    }
-                }
-
-                // Exit outer sat loop
-                sensitization_step += max_sensitization;
-            } else if (sathelper.gotTimeout) {
-                log("Timed out.\n");
-				log("time: %s\n", get_time().c_str());
-                log_flush();
-                break;
-            } else if (sensitization_step == max_sensitization) {
-                log("Failed to sensitize the bug.\n");
-				log("time: %s\n", get_time().c_str());
-                log_flush();
-            }
-        }
+			return sathelper.ez->AND(sathelper.ez->expression(ezSAT::OpOr, clause), sathelper.ez->NOT(sathelper.satgen.signals_eq(host_output, reference_output, step)));
+		}, [&](int step) {
+			return sathelper.ez->NOT(sathelper.satgen.signals_eq(host_observables, reference_observables, step));
+		});
+		if (!witness_filename.empty() && !witness.steps.empty())
+			witness.write(witness_filename);
+		store_result(result);
 	}
 } InjectVerifyPass;
 
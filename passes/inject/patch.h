@@ -0,0 +1,199 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// Bug patches describe a single injected bug relative to a reference design:
+//
+//   {"kind": "amt", "reference": ..., "module": ..., "cell": ..., "state_table": ..., "a": [...], "buggy": true}
+//   {"kind": "driver", "reference": ..., "module": ..., "target": [...], "driver": [...], "buggy": true}
+//
+// The reference is the file name of the unmodified design in the output directory.
+// Signals are stored bit by bit, constant bits as "0", "1", "x", "z", "-" or "m"
+// and wire bits as [wire name, offset].
+
+#ifndef PATCH_H
+#define PATCH_H
+
+#include "kernel/yosys.h"
+#include "libs/json11/json11.hpp"
+#include "design_cache.h"
+#include <fstream>
+#include <sstream>
+#include <errno.h>
+#include <sys/stat.h>
+
+YOSYS_NAMESPACE_BEGIN
+
+inline std::string create_bug_directory(std::string output_directory, int index){
+	std::string bug_directory = output_directory + "/" + std::to_string(index);
+	if (mkdir(bug_directory.c_str(), 0755)){
+		log_error("Error creating bug directory: %s.\n", strerror(errno));
+	}
+	return bug_directory;
+}
+
+inline json11::Json sig_to_json(const RTLIL::SigSpec &sig){
+	json11::Json::array bits;
+	for (auto bit : sig.bits()) {
+		if (bit.wire) bits.push_back(json11::Json::array{bit.wire->name.str(), bit.offset});
+		else bits.push_back(RTLIL::Const(bit.data).as_string());
+	}
+	return bits;
+}
+
+inline RTLIL::SigSpec sig_from_json(RTLIL::Module *module, const json11::Json &json){
+	RTLIL::SigSpec sig;
+	for (auto &bit : json.array_items()) {
+		if (bit.is_string()) {
+			sig.append(RTLIL::Const::from_string(bit.string_value()));
+			continue;
+		}
+		RTLIL::Wire *wire = module->wire(bit[0].string_value());
+		if (!wire || bit[1].int_value() >= wire->width)
+			log_cmd_error("Patch references missing wire %s in module %s.\n", bit[0].string_value().c_str(), log_id(module));
+		sig.append(RTLIL::SigBit(wire, bit[1].int_value()));
+	}
+	return sig;
+}
+
+inline json11::Json amt_patch(RTLIL::Cell *cell, std::string reference){
+	return json11::Json::object{
+		{"kind", "amt"},
+		{"reference", reference},
+		{"module", cell->module->name.str()},
+		{"cell", cell->name.str()},
+		{"state_table", cell->getParam(ID::STATE_TABLE).as_string()},
+		{"a", sig_to_json(cell->getPort(ID::A))},
+		{"buggy", true},
+	};
+}
+
+inline json11::Json driver_patch(RTLIL::Module *module, const RTLIL::SigSpec &target, const RTLIL::SigSpec &driver, std::string reference){
+	return json11::Json::object{
+		{"kind", "driver"},
+		{"reference", reference},
+		{"module", module->name.str()},
+		{"target", sig_to_json(target)},
+		{"driver", sig_to_json(driver)},
+		{"buggy", true},
+	};
+}
+
+inline void write_patch(std::string bug_directory, const json11::Json &patch){
+	std::string filename = bug_directory + "/bug.json";
+	std::ofstream f(filename);
+	if (f.fail())
+		log_error("Can't open patch file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+	f << patch.dump() << "\n";
+}
+
+inline json11::Json read_patch(std::string bug_directory){
+	std::string filename = bug_directory + "/bug.json";
+	std::ifstream f(filename);
+	if (f.fail())
+		log_error("Can't open patch file `%s' for reading: %s\n", filename.c_str(), strerror(errno));
+	std::stringstream buffer;
+	buffer << f.rdbuf();
+
+	std::string err;
+	json11::Json patch = json11::Json::parse(buffer.str(), err);
+	if (!err.empty())
+		log_error("Failed to parse patch file `%s': %s\n", filename.c_str(), err.c_str());
+	return patch;
+}
+
+// Reads the reference design of the patch unless the design already contains one
+inline void load_reference(RTLIL::Design *design, std::string bug_directory, const json11::Json &patch){
+	if (!design->modules_.empty()) return;
+
+	std::string output_directory = ".";
+	size_t slash = bug_directory.rfind('/');
+	if (slash != std::string::npos)
+		output_directory = bug_directory.substr(0, slash);
+	std::string reference_filename = output_directory + "/" + patch["reference"].string_value();
+	RTLIL::Design *cached = design_cache_find(reference_filename);
+	if (cached)
+		design_cache_clone(cached, design);
+	else
+		Pass::call(design, "read_rtlil " + reference_filename);
+}
+
+// Applies the patch and returns the patch that undoes it
+inline json11::Json apply_patch(RTLIL::Design *design, const json11::Json &patch){
+	RTLIL::Module *module = design->module(patch["module"].string_value());
+	if (!module)
+		log_cmd_error("Patch references missing module %s.\n", patch["module"].string_value().c_str());
+	bool buggy = patch["buggy"].bool_value();
+
+	if (patch["kind"].string_value() == "amt") {
+		RTLIL::Cell *cell = module->cell(patch["cell"].string_value());
+		if (!cell || cell->type != ID($amt))
+			log_cmd_error("Patch references missing AMT cell %s in module %s.\n", patch["cell"].string_value().c_str(), log_id(module));
+
+		json11::Json::object undo = patch.object_items();
+		undo["state_table"] = cell->getParam(ID::STATE_TABLE).as_string();
+		undo["a"] = sig_to_json(cell->getPort(ID::A));
+		undo["buggy"] = cell->has_attribute(ID(buggy));
+
+		cell->setParam(ID::STATE_TABLE, RTLIL::Const::from_string(patch["state_table"].string_value()));
+		cell->setPort(ID::A, sig_from_json(module, patch["a"]));
+		if (buggy) {
+			cell->attributes[ID(buggy)] = RTLIL::Const("buggy");
+			cell->getPort(ID::Y).as_wire()->attributes[ID(buggy)] = RTLIL::Const("buggy");
+		} else {
+			cell->attributes.erase(ID(buggy));
+			cell->getPort(ID::Y).as_wire()->attributes.erase(ID(buggy));
+		}
+		return undo;
+	}
+
+	if (patch["kind"].string_value() == "driver") {
+		RTLIL::SigSpec target = sig_from_json(module, patch["target"]);
+		RTLIL::SigSpec driver = sig_from_json(module, patch["driver"]);
+		if (!target.is_wire() || target.size() != driver.size())
+			log_cmd_error("Malformed driver patch for module %s.\n", log_id(module));
+
+		for (auto &connection : module->connections_) {
+			if (connection.first.extract(target).empty()) continue;
+
+			dict<RTLIL::SigBit, RTLIL::SigBit> original;
+			for (int i = 0; i < connection.first.size(); ++i)
+				original[connection.first[i]] = connection.second[i];
+			RTLIL::SigSpec original_driver;
+			for (auto bit : target.bits())
+				original_driver.append(original.count(bit) ? original.at(bit) : bit);
+
+			json11::Json::object undo = patch.object_items();
+			undo["driver"] = sig_to_json(original_driver);
+			undo["buggy"] = target.as_wire()->has_attribute(ID(buggy));
+
+			connection.first.replace(target, driver, &connection.second);
+			module->invalidate_sigmap();
+			if (buggy) target.as_wire()->attributes[ID(buggy)] = RTLIL::Const("buggy");
+			else target.as_wire()->attributes.erase(ID(buggy));
+			return undo;
+		}
+		log_cmd_error("Patch target %s is not driven by a connection in module %s.\n", log_signal(target), log_id(module));
+	}
+
+	log_cmd_error("Unknown patch kind `%s'.\n", patch["kind"].string_value().c_str());
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/celltypes.h"
+#include "kernel/ffinit.h"
+#include "libs/json11/json11.hpp"
+#include "libs/sha1/sha1.h"
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+YOSYS_NAMESPACE_BEGIN
+
+// Canonical description of the logic that drives the output ports of a synthesized miter and
+// the given root signals. Cells are numbered in the order in which a breadth-first search from
+// the roots reaches them, so neither the names of internal cells and wires nor the order of the
+// cells in the module change the description, and logic outside of the cone is not part of it.
+struct StructuralHasher
+{
+	RTLIL::Module *module;
+	SigMap sigmap;
+	FfInitVals initvals;
+	CellTypes ct;
+	dict<RTLIL::SigBit, std::pair<RTLIL::Cell*, std::pair<RTLIL::IdString, int>>> drivers;
+	dict<RTLIL::Cell*, int> numbers;
+	dict<RTLIL::SigBit, int> undriven;
+	std::vector<RTLIL::Cell*> queue;
+	std::string text;
+
+	StructuralHasher(RTLIL::Module *module) : module(module), sigmap(module), ct(module->design)
+	{
+		initvals.set(&sigmap, module);
+		for (auto cell : module->cells())
+			for (auto &conn : cell->connections())
+				if (ct.cell_output(cell->type, conn.first))
+					for (int i = 0; i < GetSize(conn.second); ++i)
+						drivers[sigmap(conn.second[i])] = std::make_pair(cell, std::make_pair(conn.first, i));
+	}
+
+	std::string describe(RTLIL::SigBit bit)
+	{
+		bit = sigmap(bit);
+		if (!bit.wire)
+			return RTLIL::Const(bit.data).as_string();
+		if (bit.wire->port_input)
+			return stringf("%s[%d]", bit.wire->name.c_str(), bit.offset);
+		auto it = drivers.find(bit);
+		if (it == drivers.end()) {
+			if (!undriven.count(bit))
+				undriven[bit] = GetSize(undriven);
+			return stringf("u%d", undriven.at(bit));
+		}
+		RTLIL::Cell *cell = it->second.first;
+		if (!numbers.count(cell)) {
+			numbers[cell] = GetSize(numbers);
+			queue.push_back(cell);
+		}
+		return stringf("%d.%s[%d]", numbers.at(cell), it->second.second.first.c_str(), it->second.second.second);
+	}
+
+	std::string describe(const RTLIL::SigSpec &sig)
+	{
+		std::string result;
+		for (auto bit : sig.bits())
+			result += describe(bit) + " ";
+		return result;
+	}
+
+	void add_root(const std::string &name, const RTLIL::SigSpec &sig)
+	{
+		text += name + " = " + describe(sig) + "\n";
+	}
+
+	std::string hash()
+	{
+		std::vector<RTLIL::Wire*> ports;
+		for (auto wire : module->wires())
+			if (wire->port_output)
+				ports.push_back(wire);
+		std::sort(ports.begin(), ports.end(), [](RTLIL::Wire *a, RTLIL::Wire *b) { return a->name.str() < b->name.str(); });
+		for (auto wire : ports)
+			add_root(wire->name.str(), wire);
+
+		for (int i = 0; i < GetSize(queue); ++i) {
+			RTLIL::Cell *cell = queue.at(i);
+			text += stringf("%d %s", i, cell->type.c_str());
+			std::map<std::string, RTLIL::Const> parameters;
+			for (auto &param : cell->parameters)
+				parameters[param.first.str()] = param.second;
+			for (auto &param : parameters)
+				text += " " + param.first + "=" + param.second.as_string();
+			std::map<std::string, RTLIL::SigSpec> connections;
+			for (auto &conn : cell->connections())
+				connections[conn.first.str()] = conn.second;
+			for (auto &conn : connections) {
+				if (ct.cell_output(cell->type, conn.first))
+					text += stringf(" %s:%d", conn.first.c_str(), GetSize(conn.second));
+				else
+					text += " " + conn.first + "=" + describe(conn.second);
+			}
+			if (RTLIL::builtin_ff_cell_types().count(cell->type))
+				text += " init=" + initvals(cell->getPort(ID::Q)).as_string();
+			text += "\n";
+		}
+
+		return sha1(text);
+	}
+};
+
+// The key of a verification result: the structural hash of the miter and a description of
+// every option that changes the result, e.g. the depths and the constraints
+static std::string cache_key(RTLIL::Module *miter_module, const std::vector<std::pair<std::string, RTLIL::SigSpec>> &roots, const std::string &setup)
+{
+	StructuralHasher hasher(miter_module);
+	for (auto &root : roots)
+		hasher.add_root(root.first, root.second);
+	return sha1(hasher.hash() + "\n" + setup);
+}
+
+static std::string cache_filename(const std::string &directory, const std::string &key)
+{
+	return directory + "/" + key + ".json";
+}
+
+static bool cache_lookup(const std::string &directory, const std::string &key, json11::Json &entry)
+{
+	std::ifstream f(cache_filename(directory, key));
+	if (f.fail())
+		return false;
+	std::stringstream buffer;
+	buffer << f.rdbuf();
+	std::string err;
+	entry = json11::Json::parse(buffer.str(), err);
+	if (!err.empty()) {
+		log_warning("Ignoring corrupt cache entry %s: %s\n", cache_filename(directory, key).c_str(), err.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Entries are written to a temporary file and renamed, so concurrent campaigns sharing the
+// cache directory never read a partial entry
+static void cache_store(const std::string &directory, const std::string &key, const json11::Json &entry)
+{
+	if (mkdir(directory.c_str(), 0755) && errno != EEXIST)
+		log_error("Error creating cache directory `%s': %s.\n", directory.c_str(), strerror(errno));
+	std::string filename = cache_filename(directory, key);
+	std::string temp_filename = stringf("%s.%d.tmp", filename.c_str(), int(getpid()));
+	{
+		std::ofstream f(temp_filename);
+		if (f.fail())
+			log_error("Can't open cache entry `%s' for writing: %s\n", temp_filename.c_str(), strerror(errno));
+		f << entry.dump() << "\n";
+	}
+	if (rename(temp_filename.c_str(), filename.c_str()))
+		log_error("Can't rename cache entry `%s': %s\n", temp_filename.c_str(), strerror(errno));
+	log("Stored result in cache entry %s.\n", filename.c_str());
+}
+
+// Describes the constraints of the sat options for the setup part of a cache key
+static std::string describe_constraints(const std::vector<std::pair<std::string, std::string>> &sets,
+		const std::map<int, std::vector<std::pair<std::string, std::string>>> &sets_at, const std::map<int, std::vector<std::string>> &unsets_at,
+		const std::vector<std::pair<std::string, std::string>> &sets_init, bool set_init_zero)
+{
+	std::string setup;
+	for (auto &set : sets)
+		setup += " set " + set.first + "=" + set.second;
+	for (auto &it : sets_at)
+		for (auto &set : it.second)
+			setup += stringf(" set-at %d ", it.first) + set.first + "=" + set.second;
+	for (auto &it : unsets_at)
+		for (auto &unset : it.second)
+			setup += stringf(" unset-at %d ", it.first) + unset;
+	for (auto &set : sets_init)
+		setup += " set-init " + set.first + "=" + set.second;
+	if (set_init_zero)
+		setup += " set-init-zero";
+	return setup;
+}
+
+// Logs a cached result like the verification would have
+static void log_cached_result(const std::string &key, const json11::Json &entry)
+{
+	std::string status = entry["status"].string_value();
+	log("Found cached result %s: %s.\n", key.c_str(), status.c_str());
+	if (status == "sensitized" || status == "propagated")
+		log("Sensitized the bug.\n");
+	if (status == "propagated")
+		log("Propagated the bug.\n");
+	if (status == "unsat")
+		log("Failed to sensitize the bug.\n");
+	if (entry["sensitization_step"].int_value())
+		log("Sensitized at step %d.\n", entry["sensitization_step"].int_value());
+	if (entry["propagation_step"].int_value())
+		log("Propagated at step %d.\n", entry["propagation_step"].int_value());
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
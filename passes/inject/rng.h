@@ -0,0 +1,71 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Counter-based random numbers. Every value is a hash of the seed, a stream name (e.g. the cell
+// name) and a counter, so the numbers drawn for one cell neither depend on the other cells nor on
+// the process, and every machine of a campaign reproduces the same bug space for the same seed.
+struct CounterRng
+{
+	uint64_t key, counter = 0;
+
+	// splitmix64 finalizer
+	static uint64_t mix(uint64_t x)
+	{
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+
+	CounterRng(uint64_t seed, const std::string &stream)
+	{
+		// FNV-1a, which unlike std::hash is the same on every platform
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for (unsigned char c : stream)
+			hash = (hash ^ c) * 0x100000001b3ULL;
+		key = mix(seed ^ mix(hash));
+	}
+
+	uint64_t next() { return mix(key + 0x9e3779b97f4a7c15ULL * ++counter); }
+
+	// Uniform in [0, n)
+	int operator()(int n) { return int(next() % uint64_t(n)); }
+};
+
+// Parses the argument of -shard i/N
+inline void parse_shard(const std::string &arg, int &shard, int &num_shards)
+{
+	size_t slash = arg.find('/');
+	if (slash == std::string::npos)
+		log_cmd_error("Invalid shard `%s', expected i/N!\n", arg.c_str());
+	shard = atoi(arg.substr(0, slash).c_str());
+	num_shards = atoi(arg.substr(slash + 1).c_str());
+	if (num_shards < 1 || shard < 0 || shard >= num_shards)
+		log_cmd_error("Invalid shard `%s', expected 0 <= i < N!\n", arg.c_str());
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include <array>
+#include <random>
+
+YOSYS_NAMESPACE_BEGIN
+
+// Every simulated bit carries one value per lane, 256 lanes in four machine words.
+// The word loops are plain enough for the compiler to vectorize them.
+static const int sim_words = 4;
+static const int sim_lanes = 64 * sim_words;
+typedef std::array<uint64_t, sim_words> sim_word_t;
+
+// Bit-parallel two-valued simulator for gate-level modules, i.e. modules after
+// techmap that only contain internal gates and $_FF_ cells. Undefined constants
+// and initial values simulate as zero.
+struct BitSimulator
+{
+	enum gate_type_t { G_BUF, G_NOT, G_AND, G_NAND, G_OR, G_NOR, G_XOR, G_XNOR, G_ANDNOT, G_ORNOT, G_MUX, G_NMUX };
+	struct gate_t { gate_type_t type; int a, b, s, y; };
+
+	RTLIL::Module *module;
+	SigMap sigmap;
+	dict<RTLIL::SigBit, int> slots;
+	std::vector<sim_word_t> values;
+	std::vector<gate_t> gates;
+	std::vector<std::pair<int, int>> ffs;
+	// Names the first cell that can not be simulated, empty if the module is supported
+	std::string unsupported;
+
+	BitSimulator(RTLIL::Module *module) : module(module), sigmap(module)
+	{
+		static const dict<RTLIL::IdString, gate_type_t> gate_types = {
+			{ID($_BUF_), G_BUF}, {ID($_NOT_), G_NOT}, {ID($_AND_), G_AND}, {ID($_NAND_), G_NAND},
+			{ID($_OR_), G_OR}, {ID($_NOR_), G_NOR}, {ID($_XOR_), G_XOR}, {ID($_XNOR_), G_XNOR},
+			{ID($_ANDNOT_), G_ANDNOT}, {ID($_ORNOT_), G_ORNOT}, {ID($_MUX_), G_MUX}, {ID($_NMUX_), G_NMUX},
+		};
+
+		// Slots 0 and 1 hold the constants
+		values.resize(2);
+		values[1].fill(~uint64_t(0));
+
+		std::vector<gate_t> unsorted;
+		for (auto cell : module->cells()) {
+			if (cell->type == ID($_FF_)) {
+				ffs.push_back(std::make_pair(slot(cell->getPort(ID::D)), slot(cell->getPort(ID::Q))));
+				continue;
+			}
+			if (!gate_types.count(cell->type)) {
+				unsupported = stringf("%s (%s)", log_id(cell), log_id(cell->type));
+				return;
+			}
+			gate_t gate = {gate_types.at(cell->type), slot(cell->getPort(ID::A)), 0, 0, slot(cell->getPort(ID::Y))};
+			if (cell->hasPort(ID::B)) gate.b = slot(cell->getPort(ID::B));
+			if (cell->hasPort(ID::S)) gate.s = slot(cell->getPort(ID::S));
+			unsorted.push_back(gate);
+		}
+
+		// Kahn's algorithm over the gates, flip-flop outputs and inputs are sources
+		dict<int, int> driver;
+		for (int i = 0; i < GetSize(unsorted); ++i)
+			driver[unsorted[i].y] = i;
+		std::vector<int> pending(GetSize(unsorted));
+		std::vector<std::vector<int>> consumers(GetSize(unsorted));
+		for (int i = 0; i < GetSize(unsorted); ++i) {
+			pool<int> inputs = {unsorted[i].a, unsorted[i].b, unsorted[i].s};
+			for (int input : inputs)
+				if (driver.count(input)) {
+					consumers[driver.at(input)].push_back(i);
+					pending[i]++;
+				}
+		}
+		std::vector<int> ready;
+		for (int i = 0; i < GetSize(unsorted); ++i)
+			if (!pending[i]) ready.push_back(i);
+		while (!ready.empty()) {
+			int i = ready.back();
+			ready.pop_back();
+			gates.push_back(unsorted[i]);
+			for (int consumer : consumers[i])
+				if (!--pending[consumer]) ready.push_back(consumer);
+		}
+		if (GetSize(gates) != GetSize(unsorted))
+			unsupported = "combinational loop";
+	}
+
+	int slot(RTLIL::SigBit bit)
+	{
+		bit = sigmap(bit);
+		if (!bit.wire) return bit.data == RTLIL::State::S1 ? 1 : 0;
+		auto it = slots.find(bit);
+		if (it != slots.end()) return it->second;
+		values.push_back(sim_word_t());
+		return slots[bit] = GetSize(values) - 1;
+	}
+
+	sim_word_t &value(RTLIL::SigBit bit) { return values[slot(bit)]; }
+
+	// Randomizes every flip-flop, or zeroes it, and applies the init attributes
+	void init_state(std::mt19937_64 &rng, bool zero)
+	{
+		for (auto &ff : ffs)
+			for (auto &word : values[ff.second])
+				word = zero ? 0 : rng();
+		for (auto wire : module->wires()) {
+			if (!wire->attributes.count(ID::init)) continue;
+			RTLIL::Const init = wire->attributes.at(ID::init);
+			for (int i = 0; i < wire->width && i < GetSize(init); ++i)
+				if (init[i] == RTLIL::State::S0 || init[i] == RTLIL::State::S1)
+					value(RTLIL::SigBit(wire, i)).fill(init[i] == RTLIL::State::S1 ? ~uint64_t(0) : 0);
+		}
+	}
+
+	void eval()
+	{
+		for (auto &gate : gates) {
+			const sim_word_t &a = values[gate.a], &b = values[gate.b], &s = values[gate.s];
+			sim_word_t &y = values[gate.y];
+			for (int i = 0; i < sim_words; ++i) {
+				switch (gate.type) {
+				case G_BUF: y[i] = a[i]; break;
+				case G_NOT: y[i] = ~a[i]; break;
+				case G_AND: y[i] = a[i] & b[i]; break;
+				case G_NAND: y[i] = ~(a[i] & b[i]); break;
+				case G_OR: y[i] = a[i] | b[i]; break;
+				case G_NOR: y[i] = ~(a[i] | b[i]); break;
+				case G_XOR: y[i] = a[i] ^ b[i]; break;
+				case G_XNOR: y[i] = ~(a[i] ^ b[i]); break;
+				case G_ANDNOT: y[i] = a[i] & ~b[i]; break;
+				case G_ORNOT: y[i] = a[i] | ~b[i]; break;
+				case G_MUX: y[i] = (a[i] & ~s[i]) | (b[i] & s[i]); break;
+				case G_NMUX: y[i] = ~((a[i] & ~s[i]) | (b[i] & s[i])); break;
+				}
+			}
+		}
+	}
+
+	void clock()
+	{
+		std::vector<sim_word_t> next;
+		for (auto &ff : ffs)
+			next.push_back(values[ff.first]);
+		for (int i = 0; i < GetSize(ffs); ++i)
+			values[ffs[i].second] = next[i];
+	}
+
+	// Lanes in which the two signals differ
+	sim_word_t differ(const RTLIL::SigSpec &a, const RTLIL::SigSpec &b)
+	{
+		sim_word_t result = {};
+		for (int i = 0; i < GetSize(a); ++i) {
+			int x = slot(a[i]), y = slot(b[i]);
+			for (int j = 0; j < sim_words; ++j)
+				result[j] |= values[x][j] ^ values[y][j];
+		}
+		return result;
+	}
+
+	// Lanes in which the signal equals the constant
+	sim_word_t equal(const RTLIL::SigSpec &sig, const RTLIL::Const &constant)
+	{
+		sim_word_t result;
+		result.fill(~uint64_t(0));
+		for (int i = 0; i < GetSize(sig); ++i) {
+			const sim_word_t &x = value(sig[i]);
+			for (int j = 0; j < sim_words; ++j)
+				result[j] &= constant[i] == RTLIL::State::S1 ? x[j] : ~x[j];
+		}
+		return result;
+	}
+
+	static bool lane(const sim_word_t &word, int lane) { return (word[lane / 64] >> (lane % 64)) & 1; }
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,573 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "kernel/yosys.h"
+#include "kernel/register.h"
+#include "kernel/modtools.h"
+#include "kernel/celltypes.h"
+#include "kernel/ffinit.h"
+#include "kernel/utils.h"
+#include "kernel/satgen.h"
+#include "kernel/yw.h"
+#include "libs/json11/json11.hpp"
+#include <chrono>
+#include <fstream>
+#include <functional>
+
+YOSYS_NAMESPACE_BEGIN
+
+static std::string get_time(){
+	auto now = std::chrono::system_clock::now();
+	auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
+	std::time_t now_time_t = std::chrono::system_clock::to_time_t(now);
+	char buf[100];
+	std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", std::localtime(&now_time_t));
+
+	return std::string(buf)+"."+std::to_string(milliseconds.count());
+}
+
+// Cone-of-influence reduction, removes every cell outside the sequential fan-in of the module
+// outputs, the signals named by the constraints, keep wires and keep or formal cells. opt_clean
+// alone keeps all logic that is connected to a wire with a public name.
+inline void reduce_miter(RTLIL::Design *design, RTLIL::Module *module, const std::vector<std::string> &constraints)
+{
+	int num_cells = GetSize(module->cells_);
+	ModWalker modwalker(design, module);
+
+	std::vector<RTLIL::SigBit> queue;
+	pool<RTLIL::SigBit> queued;
+	auto add_root = [&](const RTLIL::SigSpec &sig) {
+		for (auto bit : modwalker.sigmap(sig))
+			if (bit.wire && queued.insert(bit).second)
+				queue.push_back(bit);
+	};
+	pool<RTLIL::Cell *> cone;
+	auto add_cell = [&](RTLIL::Cell *cell) {
+		if (!cone.insert(cell).second) return;
+		for (auto &conn : cell->connections())
+			if (cell->input(conn.first) || !cell->output(conn.first))
+				add_root(conn.second);
+	};
+
+	for (auto wire : module->wires())
+		if (wire->port_output || wire->get_bool_attribute(ID::keep))
+			add_root(wire);
+	// Constraints that fail to parse are reported by SatHelper
+	for (auto &constraint : constraints) {
+		RTLIL::SigSpec sig;
+		if (RTLIL::SigSpec::parse_sel(sig, design, module, constraint))
+			add_root(sig);
+	}
+	for (auto cell : module->cells())
+		if (cell->has_keep_attr() || cell->type.in(ID($assert), ID($assume), ID($live), ID($fair), ID($cover)))
+			add_cell(cell);
+
+	while (!queue.empty()) {
+		RTLIL::SigBit bit = queue.back();
+		queue.pop_back();
+		pool<ModWalker::PortBit> drivers;
+		modwalker.get_drivers(drivers, bit);
+		for (auto &driver : drivers)
+			add_cell(driver.cell);
+	}
+
+	std::vector<RTLIL::Cell *> removed;
+	for (auto cell : module->cells())
+		if (!cone.count(cell))
+			removed.push_back(cell);
+	for (auto cell : removed)
+		module->remove(cell);
+	Pass::call(design, "opt_clean");
+
+	log("Cone-of-influence reduction kept %d of %d cells.\n", GetSize(module->cells_), num_cells);
+}
+
+// Structural hashing of the miter. Host and reference only differ in one AMT or driver, so most of
+// their logic is identical. Flip-flops start in one candidate class per type, parameters and init
+// value and the classes are split until all members have equivalent inputs, every other cell is
+// merged into an earlier cell with the same type, parameters and inputs. Host and reference are
+// assumed to start in the same state, flip-flops with different init values are never merged.
+// Undefined init bits are free unless they are set to zero, such flip-flops are never merged.
+inline void share_miter(RTLIL::Design *design, RTLIL::Module *module, bool set_init_zero)
+{
+	struct node_t { std::string key; std::vector<RTLIL::IdString> inputs, outputs; };
+
+	int num_cells = GetSize(module->cells_);
+	SigMap sigmap(module);
+	FfInitVals initvals(&sigmap, module);
+	CellTypes ct;
+	ct.setup_internals();
+	ct.setup_stdcells();
+
+	dict<RTLIL::Cell *, node_t> nodes;
+	std::vector<RTLIL::Cell *> ffs;
+	TopoSort<RTLIL::Cell *, RTLIL::IdString::compare_ptr_by_name<RTLIL::Cell>> comb;
+	dict<RTLIL::SigBit, RTLIL::Cell *> drivers;
+	for (auto cell : module->cells()) {
+		bool is_ff = RTLIL::builtin_ff_cell_types().count(cell->type);
+		if (!is_ff && (!ct.cell_known(cell->type) || cell->type.in(ID($anyconst), ID($anyseq), ID($allconst), ID($allseq),
+				ID($assert), ID($assume), ID($cover), ID($live), ID($fair), ID($print), ID($check))))
+			continue;
+
+		node_t &node = nodes[cell];
+		node.key = cell->type.str();
+		for (auto &param : cell->parameters)
+			node.key += " " + param.first.str() + "=" + param.second.as_string();
+		for (auto &conn : cell->connections())
+			(cell->output(conn.first) ? node.outputs : node.inputs).push_back(conn.first);
+		std::sort(node.inputs.begin(), node.inputs.end(), RTLIL::sort_by_id_str());
+		std::sort(node.outputs.begin(), node.outputs.end(), RTLIL::sort_by_id_str());
+
+		if (is_ff) {
+			RTLIL::Const init = initvals(cell->getPort(ID::Q));
+			node.key += " init=" + init.as_string();
+			if (!set_init_zero && !init.is_fully_def())
+				node.key += " " + cell->name.str();
+			ffs.push_back(cell);
+			continue;
+		}
+		comb.node(cell);
+		for (auto port : node.outputs)
+			for (auto bit : sigmap(cell->getPort(port)))
+				drivers[bit] = cell;
+	}
+	// Flip-flops are only merged through their classes, edge() would add them as nodes
+	for (auto &it : nodes) {
+		if (!comb.has_node(it.first))
+			continue;
+		for (auto port : it.second.inputs)
+			for (auto bit : sigmap(it.first->getPort(port)))
+				if (drivers.count(bit))
+					comb.edge(drivers.at(bit), it.first);
+	}
+	comb.sort();
+
+	dict<RTLIL::SigBit, RTLIL::SigBit> rep;
+	auto mapped_inputs = [&](RTLIL::Cell *cell) {
+		std::vector<RTLIL::SigBit> bits;
+		for (auto port : nodes.at(cell).inputs)
+			for (auto bit : sigmap(cell->getPort(port)))
+				bits.push_back(rep.count(bit) ? rep.at(bit) : bit);
+		return bits;
+	};
+	auto merge_outputs = [&](RTLIL::Cell *cell, RTLIL::Cell *other) {
+		for (auto port : nodes.at(cell).outputs) {
+			RTLIL::SigSpec sig = sigmap(cell->getPort(port)), other_sig = sigmap(other->getPort(port));
+			for (int i = 0; i < GetSize(sig); ++i)
+				rep[sig[i]] = rep.count(other_sig[i]) ? rep.at(other_sig[i]) : other_sig[i];
+		}
+	};
+
+	dict<RTLIL::Cell *, int> ff_class;
+	dict<std::string, int> initial_classes;
+	for (auto ff : ffs)
+		ff_class[ff] = initial_classes.insert(std::make_pair(nodes.at(ff).key, GetSize(initial_classes))).first->second;
+	int num_classes = GetSize(initial_classes);
+
+	dict<RTLIL::Cell *, RTLIL::Cell *> merged;
+	for (int iteration = 1;; ++iteration) {
+		rep.clear();
+		merged.clear();
+
+		dict<int, RTLIL::Cell *> class_rep;
+		for (auto ff : ffs) {
+			auto it = class_rep.find(ff_class.at(ff));
+			if (it == class_rep.end()) {
+				class_rep[ff_class.at(ff)] = ff;
+				continue;
+			}
+			merged[ff] = it->second;
+			merge_outputs(ff, it->second);
+		}
+
+		dict<std::pair<std::string, std::vector<RTLIL::SigBit>>, RTLIL::Cell *> hashed;
+		for (auto cell : comb.sorted) {
+			auto key = std::make_pair(nodes.at(cell).key, mapped_inputs(cell));
+			auto it = hashed.find(key);
+			if (it == hashed.end()) {
+				hashed[key] = cell;
+				continue;
+			}
+			merged[cell] = it->second;
+			merge_outputs(cell, it->second);
+		}
+
+		// Refinement only ever splits classes, so an unchanged count means a fixed point
+		dict<std::pair<int, std::vector<RTLIL::SigBit>>, int> classes;
+		dict<RTLIL::Cell *, int> next_class;
+		for (auto ff : ffs)
+			next_class[ff] = classes.insert(std::make_pair(std::make_pair(ff_class.at(ff), mapped_inputs(ff)), GetSize(classes))).first->second;
+		log_debug("Structural hashing iteration %d: %d flip-flop classes.\n", iteration, GetSize(classes));
+		if (GetSize(classes) == num_classes)
+			break;
+		num_classes = GetSize(classes);
+		ff_class.swap(next_class);
+	}
+
+	for (auto &it : merged) {
+		for (auto port : nodes.at(it.first).outputs)
+			module->connect(it.first->getPort(port), it.second->getPort(port));
+		module->remove(it.first);
+	}
+	Pass::call(design, "opt_clean");
+
+	log("Structural hashing kept %d of %d cells.\n", GetSize(module->cells_), num_cells);
+}
+
+// Hierarchical miters only flatten the path from the top module down to the modules with a bug.
+// Every other module becomes a black box that both sides of the miter share, which keeps its
+// logic out of the miter and the solver, see abstract_black_boxes.
+static pool<RTLIL::IdString> bug_path(RTLIL::Design *design, const pool<RTLIL::IdString> &bug_modules)
+{
+	dict<RTLIL::IdString, pool<RTLIL::IdString>> parents;
+	for (auto module : design->modules())
+		for (auto cell : module->cells())
+			if (design->module(cell->type))
+				parents[cell->type].insert(module->name);
+
+	pool<RTLIL::IdString> path;
+	std::vector<RTLIL::IdString> queue(bug_modules.begin(), bug_modules.end());
+	while (!queue.empty()) {
+		RTLIL::IdString name = queue.back();
+		queue.pop_back();
+		if (path.count(name)) continue;
+		path.insert(name);
+		auto it = parents.find(name);
+		if (it != parents.end())
+			queue.insert(queue.end(), it->second.begin(), it->second.end());
+	}
+	return path;
+}
+
+static void blackbox_off_path(RTLIL::Design *design, const pool<RTLIL::IdString> &bug_modules)
+{
+	pool<RTLIL::IdString> path = bug_path(design, bug_modules);
+	int num_black_boxes = 0;
+	for (auto module : design->modules()) {
+		if (path.count(module->name) || module->get_blackbox_attribute()) continue;
+		module->makeblackbox();
+		num_black_boxes++;
+	}
+	log("Hierarchical miter with %d modules on the bug path, %d modules became black boxes.\n", GetSize(path), num_black_boxes);
+}
+
+// Without bug modules the whole design is flattened, otherwise only the path to them
+inline void synthetize_miter(RTLIL::Design *design, std::string top_module, const pool<RTLIL::IdString> &bug_modules = pool<RTLIL::IdString>())
+{
+	if (!bug_modules.empty())
+		blackbox_off_path(design, bug_modules);
+	Pass::call(design, "inject_map");
+	Pass::call(design, "opt");
+	Pass::call(design, "hierarchy -check -top " + top_module);
+	Pass::call(design, "flatten");
+	Pass::call(design, "opt");
+	Pass::call(design, "wreduce");
+	Pass::call(design, "peepopt");
+	Pass::call(design, "opt_clean");
+	// TODO check whether this can be removed
+	Pass::call(design, "memory -nomap");
+	Pass::call(design, "opt_clean");
+	Pass::call(design, "opt -fast -full");
+	Pass::call(design, "memory_map");
+	Pass::call(design, "opt -full");
+	Pass::call(design, "clk2fflogic");
+	Pass::call(design, "opt -full -fine");
+}
+
+// A black box instance of the host side and the matching instance of the reference side
+struct black_box_t {
+	RTLIL::SigSpec inputs[2], outputs[2];
+	int steps = 0, history = 0;
+};
+
+// Removes the black box instances from a synthesized hierarchical miter, which leaves their outputs
+// as free variables for the solver. Instances are matched by their name below the miter top, and
+// constrain_black_boxes keeps the outputs of a matched pair equal while the inputs have been equal.
+// This over-approximates the flat miter: unsat results carry over, a propagation may be spurious.
+static std::vector<black_box_t> abstract_black_boxes(RTLIL::Design *design, RTLIL::Module *module)
+{
+	dict<std::string, std::vector<RTLIL::Cell *>> instances;
+	std::vector<RTLIL::Cell *> black_boxes;
+	for (auto cell : module->cells()) {
+		RTLIL::Module *black_box = design->module(cell->type);
+		if (!black_box || !black_box->get_blackbox_attribute()) continue;
+		black_boxes.push_back(cell);
+		std::string name = cell->name.str();
+		instances[cell->type.str() + " " + name.substr(name.find('.') + 1)].push_back(cell);
+	}
+
+	std::vector<black_box_t> pairs;
+	for (auto &it : instances) {
+		if (GetSize(it.second) != 2) continue;
+		RTLIL::Module *black_box = design->module(it.second.front()->type);
+		black_box_t pair;
+		for (int side = 0; side < 2; ++side)
+			for (auto port : black_box->ports) {
+				RTLIL::Wire *wire = black_box->wire(port);
+				RTLIL::SigSpec sig = it.second.at(side)->hasPort(port) ? it.second.at(side)->getPort(port) : RTLIL::SigSpec(RTLIL::State::Sx, wire->width);
+				(wire->port_output ? pair.outputs : pair.inputs)[side].append(sig);
+			}
+		pairs.push_back(pair);
+	}
+
+	for (auto cell : black_boxes)
+		module->remove(cell);
+	log("Abstracted %d black box instances, %d of them in matching pairs.\n", GetSize(black_boxes), 2 * GetSize(pairs));
+	return pairs;
+}
+
+// Adds the black box constraints of a newly unrolled step. Both sides are assumed to start in the
+// same state, so equal input histories imply equal outputs.
+static void constrain_black_boxes(SatHelper &sathelper, std::vector<black_box_t> &black_boxes, int step)
+{
+	for (auto &black_box : black_boxes) {
+		if (black_box.steps + 1 != step) continue;
+		int inputs_equal = sathelper.satgen.signals_eq(black_box.inputs[0], black_box.inputs[1], step);
+		black_box.history = step == 1 ? inputs_equal : sathelper.ez->AND(black_box.history, inputs_equal);
+		black_box.steps = step;
+		sathelper.ez->assume(sathelper.ez->OR(sathelper.ez->NOT(black_box.history), sathelper.satgen.signals_eq(black_box.outputs[0], black_box.outputs[1], step)));
+	}
+}
+
+// A concrete trace of the miter in the Yosys witness format, so sim -r can replay it.
+// The inputs are recorded at every step and the flip-flop state only at the first one.
+static void write_witness(std::string filename, const json11::Json &witness)
+{
+	std::ofstream f(filename);
+	if (f.fail())
+		log_error("Can't open witness file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+	f << witness.dump() << "\n";
+	log("Wrote witness with %d steps to %s.\n", GetSize(witness["steps"].array_items()), filename.c_str());
+}
+
+struct Witness
+{
+	struct signal_t { RTLIL::SigChunk chunk; bool init_only; };
+	std::vector<signal_t> signals;
+	std::vector<std::vector<RTLIL::Const>> steps;
+
+	Witness(RTLIL::Module *module)
+	{
+		for (auto wire : module->wires())
+			if (wire->port_input)
+				signals.push_back(signal_t{RTLIL::SigChunk(wire), false});
+		for (auto cell : module->cells())
+			if (RTLIL::builtin_ff_cell_types().count(cell->type))
+				for (auto &chunk : cell->getPort(ID::Q).chunks())
+					if (chunk.wire)
+						signals.push_back(signal_t{chunk, true});
+	}
+
+	json11::Json to_json() const
+	{
+		json11::Json::array signals_json;
+		int width = 0;
+		for (auto &signal : signals) {
+			signals_json.push_back(json11::Json::object{
+				{"path", witness_path(signal.chunk.wire)},
+				{"offset", signal.chunk.offset},
+				{"width", signal.chunk.width},
+				{"init_only", signal.init_only},
+			});
+			width += signal.chunk.width;
+		}
+
+		// The first signal occupies the last characters of the bit string
+		json11::Json::array steps_json;
+		for (auto &step : steps) {
+			std::string bits(width, '?');
+			int offset = 0;
+			for (int i = 0; i < GetSize(signals); ++i)
+				for (int j = 0; j < signals[i].chunk.width; ++j, ++offset) {
+					RTLIL::State bit = step[i][j];
+					bits[width - 1 - offset] = bit == RTLIL::State::S0 ? '0' : bit == RTLIL::State::S1 ? '1' : bit == RTLIL::State::Sx ? 'x' : '?';
+				}
+			steps_json.push_back(json11::Json::object{{"bits", bits}});
+		}
+
+		return json11::Json::object{
+			{"format", "Yosys Witness Trace"},
+			{"clocks", json11::Json::array()},
+			{"signals", signals_json},
+			{"steps", steps_json},
+		};
+	}
+
+	void write(std::string filename) const
+	{
+		write_witness(filename, to_json());
+	}
+};
+
+struct verify_result_t {
+	// "propagated", "sensitized", "timeout" or "unsat"
+	std::string status;
+	int sensitization_step = 0, propagation_step = 0;
+	std::vector<double> sensitization_times, propagation_times;
+};
+
+// Incremental BMC engine for bug verification. Every time step is unrolled into
+// the solver exactly once and all per-query constraints are passed as assumption
+// literals, so clauses learned for one step, one selection or one bug stay valid
+// for all later queries on the same SatHelper.
+struct BugVerifier
+{
+	SatHelper &sathelper;
+	int max_sensitization, max_propagation;
+	int unrolled_steps = 0;
+	// If set, the witness signals are appended to the model and every solution is recorded
+	Witness *witness = nullptr;
+	int model_size = 0;
+	// Black box pairs of a hierarchical miter
+	std::vector<black_box_t> black_boxes;
+
+	BugVerifier(SatHelper &sathelper, int max_sensitization, int max_propagation) :
+		sathelper(sathelper), max_sensitization(max_sensitization), max_propagation(max_propagation) { }
+
+	void unroll(int step)
+	{
+		while (unrolled_steps < step) {
+			++unrolled_steps;
+			sathelper.setup(unrolled_steps, unrolled_steps == 1);
+			constrain_black_boxes(sathelper, black_boxes, unrolled_steps);
+		}
+		sathelper.generate_model();
+		model_size = GetSize(sathelper.modelExpressions);
+		if (witness)
+			for (int t = 1; t <= step; ++t)
+				for (auto &signal : witness->signals)
+					if (t == 1 || !signal.init_only) {
+						std::vector<int> expressions = sathelper.satgen.importSigSpec(signal.chunk, t);
+						sathelper.modelExpressions.insert(sathelper.modelExpressions.end(), expressions.begin(), expressions.end());
+					}
+		log_flush();
+	}
+
+	// Stores the last solution up to the given step in the witness
+	void record_witness(int step)
+	{
+		if (!witness) return;
+		witness->steps.clear();
+		int offset = model_size;
+		for (int t = 1; t <= step; ++t) {
+			witness->steps.push_back(std::vector<RTLIL::Const>());
+			for (auto &signal : witness->signals) {
+				RTLIL::Const value(RTLIL::State::Sa, signal.chunk.width);
+				if (t == 1 || !signal.init_only)
+					for (int i = 0; i < signal.chunk.width; ++i)
+						value.bits[i] = sathelper.modelValues.at(offset++) ? RTLIL::State::S1 : RTLIL::State::S0;
+				witness->steps.back().push_back(value);
+			}
+		}
+	}
+
+	bool solve(int step, std::vector<int> assumptions, std::vector<double> &times)
+	{
+		auto start = std::chrono::steady_clock::now();
+		bool success = sathelper.solve(assumptions);
+		times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		log("Solved step %d in %.3f seconds (%s).\n", step, times.back(), success ? "sat" : sathelper.gotTimeout ? "timeout" : "unsat");
+		return success;
+	}
+
+	// Literal that pins all model variables to the values of the last solution
+	int model_literal()
+	{
+		std::vector<int> literals;
+		for (int i = 0; i < model_size; i++)
+			literals.push_back(sathelper.modelValues.at(i) ? sathelper.modelExpressions.at(i) : sathelper.ez->NOT(sathelper.modelExpressions.at(i)));
+		return sathelper.ez->expression(ezSAT::OpAnd, literals);
+	}
+
+	// The callbacks return the literal that is true iff the bug is sensitized (propagated) at the given step
+	verify_result_t verify(std::function<int(int)> sensitization, std::function<int(int)> propagation, std::vector<int> assumptions = std::vector<int>())
+	{
+		verify_result_t result;
+		result.status = "unsat";
+		sathelper.gotTimeout = false;
+
+		log("Sensitizing the bug!\n");
+		log("time: %s\n", get_time().c_str());
+		log_flush();
+		for (int sensitization_step = 1; sensitization_step <= max_sensitization; sensitization_step++) {
+			unroll(sensitization_step);
+
+			std::vector<int> sensitization_assumptions = assumptions;
+			sensitization_assumptions.push_back(sensitization(sensitization_step));
+			if (solve(sensitization_step, sensitization_assumptions, result.sensitization_times)) {
+				log("Sensitized the bug.\n");
+				log("time: %s\n", get_time().c_str());
+				log_flush();
+				sathelper.print_model();
+				log_flush();
+				result.status = "sensitized";
+				result.sensitization_step = sensitization_step;
+				record_witness(sensitization_step);
+
+				// Propagation has to continue from the sensitizing trace, which is
+				// assumed rather than asserted to keep the solver reusable
+				std::vector<int> propagation_assumptions = assumptions;
+				propagation_assumptions.push_back(model_literal());
+
+				for (int propagation_step = sensitization_step + 1; propagation_step <= max_propagation; ++propagation_step) {
+					unroll(propagation_step);
+
+					std::vector<int> step_assumptions = propagation_assumptions;
+					step_assumptions.push_back(propagation(propagation_step));
+					if (solve(propagation_step, step_assumptions, result.propagation_times)) {
+						log("Propagated the bug.\n");
+						log("time: %s\n", get_time().c_str());
+						log_flush();
+						sathelper.print_model();
+						log_flush();
+						result.status = "propagated";
+						result.propagation_step = propagation_step;
+						record_witness(propagation_step);
+						break;
+					} else if (sathelper.gotTimeout) {
+						log("Timed out.\n");
+						log("time: %s\n", get_time().c_str());
+						log_flush();
+						result.status = "timeout";
+						break;
+					}
+				}
+				return result;
+			} else if (sathelper.gotTimeout) {
+				log("Timed out.\n");
+				log("time: %s\n", get_time().c_str());
+				log_flush();
+				result.status = "timeout";
+				return result;
+			}
+		}
+
+		log("Failed to sensitize the bug.\n");
+		log("time: %s\n", get_time().c_str());
+		log_flush();
+		return result;
+	}
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
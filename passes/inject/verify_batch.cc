@@ -0,0 +1,162 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/register.h"
+#include "kernel/log.h"
+#include "batch.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct VerifyBatchPass : public Pass {
+	VerifyBatchPass() : Pass("verify_batch", "verify many bugs against one shared miter") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    verify_batch [options] <bug directory>...\n");
+		log("\n");
+		log("This pass verifies a list of bug patches written by inject_amt -patch or\n");
+		log("inject_driver -patch that all target the same AMT cell or the same driven wire.\n");
+		log("The host side of the miter contains every bug at once behind a free bug select\n");
+		log("input, so the miter is synthesized once and every bug is a single assumption on\n");
+		log("one incremental SAT solver.\n");
+		log("\n");
+		log("The current design is used as the reference design. If it is empty, the\n");
+		log("reference named in the first patch is read.\n");
+		log("\n");
+		log("Options:\n");
+		log("\n");
+		log("    -top module\n");
+		log("        the top module of the reference design\n");
+		log("    -observable signal\n");
+		log("        a signal of the top module that makes the bug observable\n");
+		log("    -max-sensitization steps\n");
+		log("    -max-propagation steps\n");
+		log("        the maximum depth of the sensitization and propagation checks\n");
+		log("    -timeout seconds\n");
+		log("        the timeout of every SAT call\n");
+		log("    -set <signal> <value>\n");
+		log("    -set-init <signal> <value>\n");
+		log("    -set-init-zero\n");
+		log("        constraints on the miter, see sat\n");
+		log("    -share\n");
+		log("        merge structurally identical logic of the host and reference sides,\n");
+		log("        this assumes that both sides start in the same state. Flip-flops\n");
+		log("        with undefined init bits are only merged with -set-init-zero.\n");
+		log("    -hierarchical\n");
+		log("        only flatten the modules that contain the buggy module, all other\n");
+		log("        modules become black boxes shared by both sides of the miter. This\n");
+		log("        over-approximates the design, so \"unsat\" results are conclusive\n");
+		log("        and propagations may be spurious.\n");
+		log("    -coi\n");
+		log("        remove all logic outside the sequential fan-in of the miter outputs,\n");
+		log("        the constraint signals and the keep wires and cells before unrolling\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		verify_options_t options;
+		std::string top_name;
+
+		log_header(design, "Executing VerifyBatch pass.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-top" && argidx+1 < args.size()) {
+				top_name = RTLIL::escape_id(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-timeout" && argidx+1 < args.size()) {
+				options.timeout = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-max-sensitization" && argidx+1 < args.size()) {
+				options.max_sensitization = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-max-propagation" && argidx+1 < args.size()) {
+				options.max_propagation = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-set" && argidx+2 < args.size()) {
+				std::string lhs = args[++argidx];
+				std::string rhs = args[++argidx];
+				options.sets.push_back(std::pair<std::string, std::string>(lhs, rhs));
+				continue;
+			}
+			if (args[argidx] == "-set-init" && argidx+2 < args.size()) {
+				std::string lhs = args[++argidx];
+				std::string rhs = args[++argidx];
+				options.sets_init.push_back(std::pair<std::string, std::string>(lhs, rhs));
+				continue;
+			}
+			if (args[argidx] == "-set-init-zero") {
+				options.set_init_zero = true;
+				continue;
+			}
+			if (args[argidx] == "-share") {
+				options.share = true;
+				continue;
+			}
+			if (args[argidx] == "-hierarchical") {
+				options.hierarchical = true;
+				continue;
+			}
+			if (args[argidx] == "-coi") {
+				options.coi = true;
+				continue;
+			}
+			if (args[argidx] == "-observable" && argidx+1 < args.size()) {
+				options.observables.push_back(args[++argidx]);
+				continue;
+			}
+			break;
+		}
+
+		std::vector<std::string> bug_directories(args.begin() + argidx, args.end());
+		if (bug_directories.empty())
+			log_cmd_error("No bug directories given!\n");
+
+		std::vector<json11::Json> patches;
+		for (auto &bug_directory : bug_directories)
+			patches.push_back(read_patch(bug_directory));
+		for (auto &patch : patches)
+			if (patch_location(patch) != patch_location(patches.front()))
+				log_cmd_error("All bugs of a batch have to target the same AMT cell or wire!\n");
+
+		load_reference(design, bug_directories.front(), patches.front());
+		RTLIL::Module *top = top_name.empty() ? design->top_module() : design->module(top_name);
+		if (!top)
+			log_cmd_error("Can not find the top module, use -top!\n");
+
+		std::vector<verify_result_t> results = verify_patches(design, top, patches, options);
+
+		log("\nBatch verification results:\n");
+		for (int i = 0; i < GetSize(results); ++i) {
+			const verify_result_t &result = results.at(i);
+			log("  %s: %s", bug_directories.at(i).c_str(), result.status.c_str());
+			if (result.sensitization_step) log(", sensitized at step %d", result.sensitization_step);
+			if (result.propagation_step) log(", propagated at step %d", result.propagation_step);
+			log("\n");
+		}
+	}
+} VerifyBatchPass;
+
+PRIVATE_NAMESPACE_END
@@ -0,0 +1,320 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/register.h"
+#include "kernel/log.h"
+#include "batch.h"
+#include "workers.h"
+#include <dirent.h>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct bug_t {int index; std::string directory; json11::Json patch;};
+
+// Returns the numbered bug directories that contain a patch, ordered by bug index
+static std::vector<bug_t> find_bugs(std::string output_directory)
+{
+	std::vector<bug_t> bugs;
+	DIR *dir = opendir(output_directory.c_str());
+	if (!dir)
+		log_cmd_error("Can't open output directory `%s': %s\n", output_directory.c_str(), strerror(errno));
+	for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+		std::string name = entry->d_name;
+		if (name.empty() || name.find_first_not_of("0123456789") != std::string::npos)
+			continue;
+		std::string bug_directory = output_directory + "/" + name;
+		if (!check_file_exists(bug_directory + "/bug.json"))
+			continue;
+		bugs.push_back(bug_t{atoi(name.c_str()), bug_directory, json11::Json()});
+	}
+	closedir(dir);
+
+	std::sort(bugs.begin(), bugs.end(), [](const bug_t &a, const bug_t &b) { return a.index < b.index; });
+	for (auto &bug : bugs)
+		bug.patch = read_patch(bug.directory);
+	return bugs;
+}
+
+static json11::Json result_to_json(const bug_t &bug, const verify_result_t &result)
+{
+	return json11::Json::object{
+		{"bug", bug.index},
+		{"directory", bug.directory},
+		{"status", result.status},
+		{"sensitization_step", result.sensitization_step},
+		{"propagation_step", result.propagation_step},
+		{"sensitization_times", json11::Json(result.sensitization_times)},
+		{"propagation_times", json11::Json(result.propagation_times)},
+	};
+}
+
+static json11::Json error_to_json(const bug_t &bug, const std::string &error)
+{
+	std::string message = error;
+	while (!message.empty() && message.back() == '\n')
+		message.pop_back();
+	return json11::Json::object{
+		{"bug", bug.index},
+		{"directory", bug.directory},
+		{"status", "error"},
+		{"error", message},
+	};
+}
+
+struct VerifyBugsPass : public Pass {
+	VerifyBugsPass() : Pass("verify_bugs", "verify a directory of bug patches with worker processes") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    verify_bugs [options] <output directory>\n");
+		log("\n");
+		log("This pass verifies every numbered bug directory with a bug.json patch in the\n");
+		log("output directory of inject_amt -patch or inject_driver -patch. The bugs are\n");
+		log("split into contiguous ranges, one per worker, and each worker verifies the\n");
+		log("bugs of its range that share an AMT cell or driven wire on one miter, like\n");
+		log("verify_batch.\n");
+		log("\n");
+		log("Every result is appended as one JSON object per line to the results file as\n");
+		log("soon as the bug is verified:\n");
+		log("\n");
+		log("    {\"bug\": 3, \"directory\": \"out/3\", \"status\": \"propagated\",\n");
+		log("     \"sensitization_step\": 2, \"propagation_step\": 5,\n");
+		log("     \"sensitization_times\": [...], \"propagation_times\": [...]}\n");
+		log("\n");
+		log("The status is one of \"propagated\", \"sensitized\", \"timeout\" or \"unsat\" and\n");
+		log("the times are the durations of the individual SAT calls in seconds. Lines of\n");
+		log("different workers are interleaved, use the bug index to order them.\n");
+		log("\n");
+		log("A bug that can not be verified, for example because its patch does not match\n");
+		log("the reference design, gets the status \"error\" and an \"error\" message\n");
+		log("instead of the steps and times. The worker continues with the next bug.\n");
+		log("\n");
+		log("The current design is used as the reference design. If it is empty, the\n");
+		log("reference named in the first patch is read.\n");
+		log("\n");
+		log("Options:\n");
+		log("\n");
+		log("    -j workers\n");
+		log("        verify the bugs with the given number of worker processes. Workers\n");
+		log("        do not write to the log, only to the results file.\n");
+		log("    -results file\n");
+		log("        the results file, <output directory>/results.jsonl by default\n");
+		log("    -top module\n");
+		log("        the top module of the reference design\n");
+		log("    -observable signal\n");
+		log("        a signal of the top module that makes the bug observable\n");
+		log("    -max-sensitization steps\n");
+		log("    -max-propagation steps\n");
+		log("        the maximum depth of the sensitization and propagation checks\n");
+		log("    -timeout seconds\n");
+		log("        the timeout of every SAT call, a bug whose call times out is reported\n");
+		log("        as \"timeout\" and the worker continues with the next bug\n");
+		log("    -set <signal> <value>\n");
+		log("    -set-init <signal> <value>\n");
+		log("    -set-init-zero\n");
+		log("        constraints on the miter, see sat\n");
+		log("    -share\n");
+		log("        merge structurally identical logic of the host and reference sides,\n");
+		log("        this assumes that both sides start in the same state. Flip-flops\n");
+		log("        with undefined init bits are only merged with -set-init-zero.\n");
+		log("    -hierarchical\n");
+		log("        only flatten the modules that contain the buggy module, all other\n");
+		log("        modules become black boxes shared by both sides of the miter. This\n");
+		log("        over-approximates the design, so \"unsat\" results are conclusive\n");
+		log("        and propagations may be spurious.\n");
+		log("    -coi\n");
+		log("        remove all logic outside the sequential fan-in of the miter outputs,\n");
+		log("        the constraint signals and the keep wires and cells before unrolling\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		verify_options_t options;
+		std::string top_name, results_filename;
+		int num_workers = 1;
+
+		log_header(design, "Executing VerifyBugs pass.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_workers = max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-results" && argidx+1 < args.size()) {
+				results_filename = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-top" && argidx+1 < args.size()) {
+				top_name = RTLIL::escape_id(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-timeout" && argidx+1 < args.size()) {
+				options.timeout = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-max-sensitization" && argidx+1 < args.size()) {
+				options.max_sensitization = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-max-propagation" && argidx+1 < args.size()) {
+				options.max_propagation = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-set" && argidx+2 < args.size()) {
+				std::string lhs = args[++argidx];
+				std::string rhs = args[++argidx];
+				options.sets.push_back(std::pair<std::string, std::string>(lhs, rhs));
+				continue;
+			}
+			if (args[argidx] == "-set-init" && argidx+2 < args.size()) {
+				std::string lhs = args[++argidx];
+				std::string rhs = args[++argidx];
+				options.sets_init.push_back(std::pair<std::string, std::string>(lhs, rhs));
+				continue;
+			}
+			if (args[argidx] == "-set-init-zero") {
+				options.set_init_zero = true;
+				continue;
+			}
+			if (args[argidx] == "-share") {
+				options.share = true;
+				continue;
+			}
+			if (args[argidx] == "-hierarchical") {
+				options.hierarchical = true;
+				continue;
+			}
+			if (args[argidx] == "-coi") {
+				options.coi = true;
+				continue;
+			}
+			if (args[argidx] == "-observable" && argidx+1 < args.size()) {
+				options.observables.push_back(args[++argidx]);
+				continue;
+			}
+			break;
+		}
+		if (argidx+1 != args.size())
+			log_cmd_error("Missing or extra output directory argument!\n");
+		std::string output_directory = args[argidx];
+		while (output_directory.size() > 1 && output_directory.back() == '/')
+			output_directory.pop_back();
+		if (results_filename.empty())
+			results_filename = output_directory + "/results.jsonl";
+
+		std::vector<bug_t> bugs = find_bugs(output_directory);
+		if (bugs.empty())
+			log_cmd_error("No bug patches found in `%s'!\n", output_directory.c_str());
+		for (auto &bug : bugs)
+			if (bug.patch["reference"] != bugs.front().patch["reference"])
+				log_cmd_error("Bugs %d and %d have different reference designs!\n", bugs.front().index, bug.index);
+
+		load_reference(design, bugs.front().directory, bugs.front().patch);
+		RTLIL::Module *top = top_name.empty() ? design->top_module() : design->module(top_name);
+		if (!top)
+			log_cmd_error("Can not find the top module, use -top!\n");
+
+		FILE *results_file = fopen(results_filename.c_str(), "w");
+		if (!results_file)
+			log_cmd_error("Can't open results file `%s' for writing: %s\n", results_filename.c_str(), strerror(errno));
+		fclose(results_file);
+
+		num_workers = min(num_workers, GetSize(bugs));
+		log("Verifying %d bugs with %d worker%s.\n", GetSize(bugs), num_workers, num_workers == 1 ? "" : "s");
+
+		int num_failed = run_workers(num_workers, [&](int worker) {
+			int first_index = GetSize(bugs) * worker / num_workers;
+			int last_index = GetSize(bugs) * (worker + 1) / num_workers;
+
+			// Every line is written and flushed on its own, appends of different workers never mix
+			FILE *f = fopen(results_filename.c_str(), "a");
+			if (!f)
+				log_error("Can't open results file `%s' for appending: %s\n", results_filename.c_str(), strerror(errno));
+			auto write_result = [&](const json11::Json &result) {
+				std::string line = result.dump() + "\n";
+				fputs(line.c_str(), f);
+				fflush(f);
+			};
+
+			dict<std::string, std::vector<int>> locations;
+			for (int i = first_index; i < last_index; ++i)
+				locations[patch_location(bugs.at(i).patch)].push_back(i);
+
+			// A failing bug must not take the rest of the range with it
+			bool restore_log_cmd_error_throw = log_cmd_error_throw;
+			log_cmd_error_throw = true;
+			for (auto &it : locations) {
+				pool<int> verified;
+				auto verify_group = [&](const std::vector<int> &group) {
+					std::vector<json11::Json> patches;
+					for (int i : group)
+						patches.push_back(bugs.at(i).patch);
+					try {
+						verify_patches(design, top, patches, options, [&](int i, const verify_result_t &result) {
+							write_result(result_to_json(bugs.at(group.at(i)), result));
+							verified.insert(group.at(i));
+						});
+					} catch (const log_cmd_error_exception &) {
+						return log_last_error;
+					} catch (const std::exception &e) {
+						return std::string(e.what());
+					}
+					return std::string();
+				};
+
+				// After a failed batch, the remaining bugs are retried one by one to find the failing ones
+				if (verify_group(it.second).empty())
+					continue;
+				for (int i : it.second) {
+					if (verified.count(i))
+						continue;
+					std::string error = verify_group({i});
+					if (!error.empty())
+						write_result(error_to_json(bugs.at(i), error));
+				}
+			}
+			log_cmd_error_throw = restore_log_cmd_error_throw;
+			fclose(f);
+		});
+
+		// Summarize the stream rather than results of the workers, which are not shared
+		dict<std::string, int> status_count;
+		int num_results = 0;
+		std::ifstream results_stream(results_filename);
+		for (std::string line; std::getline(results_stream, line); ) {
+			std::string err;
+			json11::Json result = json11::Json::parse(line, err);
+			if (!err.empty()) continue;
+			status_count[result["status"].string_value()]++;
+			num_results++;
+		}
+		log("Wrote %d results to %s.\n", num_results, results_filename.c_str());
+		for (auto status : {"propagated", "sensitized", "timeout", "unsat", "error"})
+			log("  %-10s %d\n", status, status_count[status]);
+		if (num_failed)
+			log_warning("%d of %d workers failed.\n", num_failed, num_workers);
+		if (num_results != GetSize(bugs))
+			log_warning("Expected %d results, got %d.\n", GetSize(bugs), num_results);
+	}
+} VerifyBugsPass;
+
+PRIVATE_NAMESPACE_END
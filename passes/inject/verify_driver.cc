@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <string.h>
 #include "selection.h"
+#include "result_cache.h"
 #include <chrono>
 
 USING_YOSYS_NAMESPACE
@@ -159,6 +160,7 @@ struct VerifyDriverPass : public Pass {
 		std::vector<std::string> observables;
 		int max_sensitization = 20, max_propagation = 32, initsteps = 0, timeout = 0, stepsize = 1;
 		bool set_init_zero = false, show_inputs = false, show_outputs = false;
+		std::string cache_directory;
 
 		log_header(design, "Executing VerifyDriverPass pass.\n");
 
@@ -228,6 +230,10 @@ struct VerifyDriverPass : public Pass {
 				observables.push_back(args[++argidx]);
 				continue;
 			}
+			if (args[argidx] == "-cache" && argidx+1 < args.size()) {
+				cache_directory = args[++argidx];
+				continue;
+			}
 		}
 
         RTLIL::Module *host_module = design->module("\\host");
@@ -298,6 +304,22 @@ struct VerifyDriverPass : public Pass {
         if (host_observables.size() != reference_observables.size())
             log_cmd_error("Observables expression with different lhs and rhs sizes.\n");
 
+		// Structurally identical bugs with the same setup, e.g. of an earlier campaign, have the same result
+		std::string key;
+		if (!cache_directory.empty()) {
+			std::string setup = stringf("verify_driver %d %d", max_sensitization, max_propagation);
+			setup += describe_constraints(sets, sets_at, unsets_at, sets_init, set_init_zero);
+			key = cache_key(miter_module, {}, setup);
+
+			json11::Json entry;
+			if (cache_lookup(cache_directory, key, entry)) {
+				log_cached_result(key, entry);
+				return;
+			}
+		}
+		std::string status = "unsat";
+		int sensitized_step = 0, propagated_step = 0;
+
 		log("Sensitizing the bug!\n");
 		log("time: %s\n", get_time().c_str());
 		log_flush();
@@ -313,6 +335,8 @@ struct VerifyDriverPass : public Pass {
                 log("Sensitized the bug.\n");
 				log("time: %s\n", get_time().c_str());
 				log_flush();
+                status = "sensitized";
+                sensitized_step = sensitization_step;
                 sathelper.print_model();
                 log_flush();
 
@@ -334,6 +358,8 @@ struct VerifyDriverPass : public Pass {
                         log("Propagated the bug.\n");
 						log("time: %s\n", get_time().c_str());
 						log_flush();
+                        status = "propagated";
+                        propagated_step = propagation_step;
                         sathelper.print_model();
                         log_flush();
                         break;
@@ -341,6 +367,7 @@ struct VerifyDriverPass : public Pass {
                         log("Timed out.\n");
 						log("time: %s\n", get_time().c_str());
                         log_flush();
+                        status = "timeout";
                         break;
                     }
                 }
@@ -351,6 +378,7 @@ struct VerifyDriverPass : public Pass {
                 log("Timed out.\n");
 				log("time: %s\n", get_time().c_str());
                 log_flush();
+                status = "timeout";
                 break;
             } else if (sensitization_step == max_sensitization) {
                 log("Failed to sensitize the bug.\n");
@@ -358,6 +386,13 @@ struct VerifyDriverPass : public Pass {
 				log_flush();
             }
         }
+
+		if (!key.empty() && status != "timeout")
+			cache_store(cache_directory, key, json11::Json::object{
+				{"status", status},
+				{"sensitization_step", sensitized_step},
+				{"propagation_step", propagated_step},
+			});
 	}
 } VerifyDriverPass;
 
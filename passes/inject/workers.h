@@ -0,0 +1,89 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include "kernel/yosys.h"
+#include <functional>
+#include <errno.h>
+
+#ifndef _WIN32
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+// The RTLIL kernel is not thread-safe (IdString reference counting is global),
+// so workers are forked processes. Every worker starts from a copy-on-write
+// image of the parent, which gives it a private clone of the whole design.
+// Returns the number of workers that failed, reporting them is left to the caller.
+static int run_workers(int num_workers, const std::function<void(int)> &body)
+{
+	if (num_workers <= 1) {
+		body(0);
+		return 0;
+	}
+
+#ifdef _WIN32
+	for (int worker = 0; worker < num_workers; ++worker)
+		body(worker);
+	return 0;
+#else
+	// Unflushed output would otherwise be duplicated into every worker
+	log_flush();
+	fflush(stdout);
+	fflush(stderr);
+
+	std::vector<pid_t> pids;
+	for (int worker = 0; worker < num_workers; ++worker) {
+		pid_t pid = fork();
+		if (pid < 0)
+			log_error("Error forking worker %d: %s.\n", worker, strerror(errno));
+		if (pid == 0) {
+			// Workers only report errors, the parent owns the log
+			log_files.clear();
+			log_streams.clear();
+			log_errfile = stderr;
+			try {
+				body(worker);
+			} catch (...) {
+				_exit(1);
+			}
+			fflush(stdout);
+			_exit(0);
+		}
+		pids.push_back(pid);
+	}
+
+	int num_failed = 0;
+	for (int worker = 0; worker < num_workers; ++worker) {
+		int status = 0;
+		if (waitpid(pids.at(worker), &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			++num_failed;
+	}
+	return num_failed;
+#endif
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -62,6 +62,9 @@ struct OptPass : public Pass {
 		log("Note: Options in square brackets (such as [-keepdc]) are passed through to\n");
 		log("the opt_* commands when given to 'opt'.\n");
 		log("\n");
+		log("All of these passes except opt_share optimize the selected modules concurrently\n");
+		log("when more than one thread is set with 'threads'.\n");
+		log("\n");
 		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
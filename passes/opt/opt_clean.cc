@@ -42,6 +42,14 @@ struct keep_cache_t
 		cache.clear();
 	}
 
+	// Fills the cache for all modules, so that the workers of execute_modules() only read it
+	void prepare()
+	{
+		for (auto module : design->modules())
+			query(module);
+		cache.settle();
+	}
+
 	bool query(Module *module)
 	{
 		log_assert(design != nullptr);
@@ -97,11 +105,14 @@ struct keep_cache_t
 
 keep_cache_t keep_cache;
 CellTypes ct_reg, ct_all;
-int count_rm_cells, count_rm_wires;
+
+// Per thread, modules are cleaned concurrently by the workers of execute_modules()
+thread_local int count_rm_cells, count_rm_wires;
+thread_local bool opt_did_something;
 
 void rmunused_module_cells(Module *module, bool verbose)
 {
-	SigMap sigmap(module);
+	const SigMap &sigmap = module->sigmap();
 	dict<IdString, pool<Cell*>> mem2cells;
 	pool<IdString> mem_unused;
 	pool<Cell*> queue, unused;
@@ -200,7 +211,7 @@ void rmunused_module_cells(Module *module, bool verbose)
 	for (auto cell : unused) {
 		if (verbose)
 			log_debug("  removing unused `%s' cell `%s'.\n", cell->type.c_str(), cell->name.c_str());
-		module->design->scratchpad_set_bool("opt.did_something", true);
+		opt_did_something = true;
 		if (RTLIL::builtin_ff_cell_types().count(cell->type))
 			ffinit.remove_init(cell->getPort(ID::Q));
 		module->remove(cell);
@@ -308,7 +319,7 @@ bool rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 				connected_signals.add(it2.second);
 		}
 
-	SigMap assign_map(module);
+	SigMap assign_map = module->sigmap();
 	pool<RTLIL::SigSpec> direct_sigs;
 	pool<RTLIL::Wire*> direct_wires;
 	for (auto &it : module->cells_) {
@@ -333,6 +344,7 @@ bool rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 	}
 
 	module->connections_.clear();
+	module->invalidate_sigmap();
 
 	SigPool used_signals;
 	SigPool raw_used_signals;
@@ -485,7 +497,7 @@ bool rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 		log_debug("  removed %d unused temporary wires.\n", del_temp_wires_count);
 
 	if (!del_wires_queue.empty())
-		module->design->scratchpad_set_bool("opt.did_something", true);
+		opt_did_something = true;
 
 	return !del_wires_queue.empty();
 }
@@ -496,7 +508,7 @@ bool rmunused_module_init(RTLIL::Module *module, bool verbose)
 	CellTypes fftypes;
 	fftypes.setup_internals_mem();
 
-	SigMap sigmap(module);
+	SigMap sigmap = module->sigmap();
 	dict<SigBit, State> qbits;
 
 	for (auto cell : module->cells())
@@ -566,7 +578,7 @@ bool rmunused_module_init(RTLIL::Module *module, bool verbose)
 	}
 
 	if (did_something)
-		module->design->scratchpad_set_bool("opt.did_something", true);
+		opt_did_something = true;
 
 	return did_something;
 }
@@ -593,7 +605,7 @@ void rmunused_module(RTLIL::Module *module, bool purge_mode, bool verbose, bool
 		module->remove(cell);
 	}
 	if (!delcells.empty())
-		module->design->scratchpad_set_bool("opt.did_something", true);
+		opt_did_something = true;
 
 	rmunused_module_cells(module, verbose);
 	while (rmunused_module_signals(module, purge_mode, verbose)) { }
@@ -602,8 +614,55 @@ void rmunused_module(RTLIL::Module *module, bool purge_mode, bool verbose, bool
 		while (rmunused_module_signals(module, purge_mode, verbose)) { }
 }
 
-struct OptCleanPass : public Pass {
-	OptCleanPass() : Pass("opt_clean", "remove unused cells and wires") { }
+// Removes unused cells and wires from all given modules, returns whether anything changed
+static bool rmunused_modules(ParallelModulePass *pass, RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules,
+		bool purge_mode, bool verbose, bool warn)
+{
+	keep_cache.reset(design);
+	keep_cache.prepare();
+
+	ct_reg.setup_internals_mem();
+	ct_reg.setup_internals_anyinit();
+	ct_reg.setup_stdcells_mem();
+	ct_reg.settle();
+
+	ct_all.setup(design);
+	ct_all.settle();
+
+	std::vector<int> module_rm_cells(GetSize(modules)), module_rm_wires(GetSize(modules));
+	std::vector<char> module_did_something(GetSize(modules));
+	pass->execute_modules(design, modules, [&](RTLIL::Module *module, int index) {
+		if (warn ? module->has_processes_warn() : module->has_processes())
+			return;
+		count_rm_cells = 0;
+		count_rm_wires = 0;
+		opt_did_something = false;
+		rmunused_module(module, purge_mode, verbose, true);
+		if (opt_did_something)
+			module->compact_arena();
+		module_rm_cells[index] = count_rm_cells;
+		module_rm_wires[index] = count_rm_wires;
+		module_did_something[index] = opt_did_something;
+	});
+
+	keep_cache.reset();
+	ct_reg.clear();
+	ct_all.clear();
+
+	count_rm_cells = 0;
+	count_rm_wires = 0;
+	bool did_something = false;
+	for (int i = 0; i < GetSize(modules); i++) {
+		count_rm_cells += module_rm_cells[i];
+		count_rm_wires += module_rm_wires[i];
+		if (module_did_something[i])
+			did_something = true;
+	}
+	return did_something;
+}
+
+struct OptCleanPass : public ParallelModulePass {
+	OptCleanPass() : ParallelModulePass("opt_clean", "remove unused cells and wires") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -616,6 +675,8 @@ struct OptCleanPass : public Pass {
 		log("after the passes that do the actual work.\n");
 		log("\n");
 		log("This pass only operates on completely selected modules without processes.\n");
+		log("In modules that allocate their cells and wires from an arena (see 'help arena'),\n");
+		log("the slabs that are left empty are released afterwards.\n");
 		log("\n");
 		log("    -purge\n");
 		log("        also remove internal nets if they have a public name\n");
@@ -638,22 +699,8 @@ struct OptCleanPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		keep_cache.reset(design);
-
-		ct_reg.setup_internals_mem();
-		ct_reg.setup_internals_anyinit();
-		ct_reg.setup_stdcells_mem();
-
-		ct_all.setup(design);
-
-		count_rm_cells = 0;
-		count_rm_wires = 0;
-
-		for (auto module : design->selected_whole_modules_warn()) {
-			if (module->has_processes_warn())
-				continue;
-			rmunused_module(module, purge_mode, true, true);
-		}
+		if (rmunused_modules(this, design, design->selected_whole_modules_warn(), purge_mode, true, true))
+			design->scratchpad_set_bool("opt.did_something", true);
 
 		if (count_rm_cells > 0 || count_rm_wires > 0)
 			log("Removed %d unused cells and %d unused wires.\n", count_rm_cells, count_rm_wires);
@@ -662,15 +709,12 @@ struct OptCleanPass : public Pass {
 		design->sort();
 		design->check();
 
-		keep_cache.reset();
-		ct_reg.clear();
-		ct_all.clear();
 		log_pop();
 	}
 } OptCleanPass;
 
-struct CleanPass : public Pass {
-	CleanPass() : Pass("clean", "remove unused cells and wires") { }
+struct CleanPass : public ParallelModulePass {
+	CleanPass() : ParallelModulePass("clean", "remove unused cells and wires") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -700,22 +744,8 @@ struct CleanPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		keep_cache.reset(design);
-
-		ct_reg.setup_internals_mem();
-		ct_reg.setup_internals_anyinit();
-		ct_reg.setup_stdcells_mem();
-
-		ct_all.setup(design);
-
-		count_rm_cells = 0;
-		count_rm_wires = 0;
-
-		for (auto module : design->selected_whole_modules()) {
-			if (module->has_processes())
-				continue;
-			rmunused_module(module, purge_mode, ys_debug(), true);
-		}
+		if (rmunused_modules(this, design, design->selected_whole_modules(), purge_mode, ys_debug(), false))
+			design->scratchpad_set_bool("opt.did_something", true);
 
 		log_suppressed();
 		if (count_rm_cells > 0 || count_rm_wires > 0)
@@ -724,10 +754,6 @@ struct CleanPass : public Pass {
 		design->optimize();
 		design->sort();
 		design->check();
-
-		keep_cache.reset();
-		ct_reg.clear();
-		ct_all.clear();
 	}
 } CleanPass;
 
@@ -45,6 +45,7 @@ struct OptDffOptions
 struct OptDffWorker
 {
 	const OptDffOptions &opt;
+	const CellTypes &ct;
 
 	Module *module;
 	typedef std::pair<RTLIL::Cell*, int> cell_int_t;
@@ -61,7 +62,7 @@ struct OptDffWorker
 	// Used as a queue.
 	std::vector<Cell *> dff_cells;
 
-	OptDffWorker(const OptDffOptions &opt, Module *mod) : opt(opt), module(mod), sigmap(mod), initvals(&sigmap, mod) {
+	OptDffWorker(const OptDffOptions &opt, const CellTypes &ct, Module *mod) : opt(opt), ct(ct), module(mod), sigmap(mod->sigmap()), initvals(&sigmap, mod) {
 		// Gathering two kinds of information here for every sigmapped SigBit:
 		//
 		// - bitusers: how many users it has (muxes will only be merged into FFs if this is 1, making the FF the only user)
@@ -735,7 +736,7 @@ struct OptDffWorker
 	}
 
 	bool run_constbits() {
-		ModWalker modwalker(module->design, module);
+		ModWalker modwalker(module->design, ct, module);
 		QuickConeSat qcsat(modwalker);
 
 		// Run as a separate sub-pass, so that we don't mutate (non-FF) cells under ModWalker.
@@ -844,8 +845,8 @@ struct OptDffWorker
 	}
 };
 
-struct OptDffPass : public Pass {
-	OptDffPass() : Pass("opt_dff", "perform DFF optimizations") { }
+struct OptDffPass : public ParallelModulePass {
+	OptDffPass() : ParallelModulePass("opt_dff", "perform DFF optimizations") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -916,14 +917,24 @@ struct OptDffPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		bool did_something = false;
-		for (auto mod : design->selected_modules()) {
-			OptDffWorker worker(opt, mod);
+		// Set up once here, in a worker this would read modules that other workers modify
+		CellTypes ct(design);
+		ct.settle();
+
+		std::vector<RTLIL::Module*> modules = design->selected_modules();
+		std::vector<char> module_did_something(GetSize(modules));
+		execute_modules(design, modules, [&](RTLIL::Module *mod, int index) {
+			OptDffWorker worker(opt, ct, mod);
 			if (worker.run())
-				did_something = true;
+				module_did_something[index] = true;
 			if (worker.run_constbits())
+				module_did_something[index] = true;
+		});
+
+		bool did_something = false;
+		for (char module_did : module_did_something)
+			if (module_did)
 				did_something = true;
-		}
 
 		if (did_something)
 			design->scratchpad_set_bool("opt.did_something", true);
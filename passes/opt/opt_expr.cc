@@ -29,11 +29,12 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-bool did_something;
+// Per thread, modules are optimized concurrently by the workers of execute_modules()
+thread_local bool did_something;
 
 void replace_undriven(RTLIL::Module *module, const CellTypes &ct)
 {
-	SigMap sigmap(module);
+	SigMap sigmap = module->sigmap();
 	SigPool driven_signals;
 	SigPool used_signals;
 	SigPool all_signals;
@@ -94,7 +95,7 @@ void replace_undriven(RTLIL::Module *module, const CellTypes &ct)
 
 	if (!revisit_initwires.empty())
 	{
-		SigMap sm2(module);
+		const SigMap &sm2 = module->sigmap();
 
 		for (auto wire : revisit_initwires) {
 			SigSpec sig = sm2(wire);
@@ -399,7 +400,7 @@ void replace_const_cells(RTLIL::Design *design, RTLIL::Module *module, bool cons
 	ct_combinational.setup_internals();
 	ct_combinational.setup_stdcells();
 
-	SigMap assign_map(module);
+	SigMap assign_map = module->sigmap();
 	dict<RTLIL::SigSpec, RTLIL::SigSpec> invert_map;
 
 	TopoSort<RTLIL::Cell*, RTLIL::IdString::compare_ptr_by_name<RTLIL::Cell>> cells;
@@ -2198,7 +2199,7 @@ skip_alu_split:
 }
 
 void replace_const_connections(RTLIL::Module *module) {
-	SigMap assign_map(module);
+	const SigMap &assign_map = module->sigmap();
 	for (auto cell : module->selected_cells())
 	{
 		std::vector<std::pair<RTLIL::IdString, SigSpec>> changes;
@@ -2214,8 +2215,8 @@ void replace_const_connections(RTLIL::Module *module) {
 	}
 }
 
-struct OptExprPass : public Pass {
-	OptExprPass() : Pass("opt_expr", "perform const folding and simple expression rewriting") { }
+struct OptExprPass : public ParallelModulePass {
+	OptExprPass() : ParallelModulePass("opt_expr", "perform const folding and simple expression rewriting") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -2300,7 +2301,11 @@ struct OptExprPass : public Pass {
 		extra_args(args, argidx, design);
 
 		CellTypes ct(design);
-		for (auto module : design->selected_modules())
+		ct.settle();
+
+		std::vector<RTLIL::Module*> modules = design->selected_modules();
+		std::vector<char> module_did_something(GetSize(modules));
+		execute_modules(design, modules, [&](RTLIL::Module *module, int index)
 		{
 			log("Optimizing module %s.\n", log_id(module));
 
@@ -2308,7 +2313,7 @@ struct OptExprPass : public Pass {
 				did_something = false;
 				replace_undriven(module, ct);
 				if (did_something)
-					design->scratchpad_set_bool("opt.did_something", true);
+					module_did_something[index] = true;
 			}
 
 			do {
@@ -2316,21 +2321,25 @@ struct OptExprPass : public Pass {
 					did_something = false;
 					replace_const_cells(design, module, false /* consume_x */, mux_undef, mux_bool, do_fine, keepdc, noclkinv);
 					if (did_something)
-						design->scratchpad_set_bool("opt.did_something", true);
+						module_did_something[index] = true;
 				} while (did_something);
 				if (!keepdc)
 					replace_const_cells(design, module, true /* consume_x */, mux_undef, mux_bool, do_fine, keepdc, noclkinv);
 				if (did_something)
-					design->scratchpad_set_bool("opt.did_something", true);
+					module_did_something[index] = true;
 			} while (did_something);
 
 			did_something = false;
 			replace_const_connections(module);
 			if (did_something)
-				design->scratchpad_set_bool("opt.did_something", true);
+				module_did_something[index] = true;
 
 			log_suppressed();
-		}
+		});
+
+		for (char module_did : module_did_something)
+			if (module_did)
+				design->scratchpad_set_bool("opt.did_something", true);
 
 		log_pop();
 	}
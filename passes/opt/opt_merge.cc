@@ -22,6 +22,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include "kernel/celltypes.h"
+#include "kernel/compactsig.h"
 #include "libs/sha1/sha1.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -65,47 +66,45 @@ struct OptMergeWorker
 		}
 	}
 
-	std::string int_to_hash_string(unsigned int v)
+	// The type, parameters and normalized inputs of a cell, equal for cells that can be merged
+	struct cell_key_t
 	{
-		if (v == 0)
-			return "0";
-		std::string str = "";
-		while (v > 0) {
-			str += 'a' + (v & 15);
-			v = v >> 4;
+		RTLIL::IdString type;
+		const dict<RTLIL::IdString, RTLIL::Const> *parameters;
+		unsigned int parameters_hash;
+		std::vector<std::pair<RTLIL::IdString, CompactSigSpec>> ports;
+
+		CompactSigSpec &port(RTLIL::IdString name)
+		{
+			for (auto &it : ports)
+				if (it.first == name)
+					return it.second;
+			log_abort();
 		}
-		return str;
-	}
 
-        uint64_t hash_cell_parameters_and_connections(const RTLIL::Cell *cell)
+		bool operator==(const cell_key_t &other) const {
+			return type == other.type && parameters_hash == other.parameters_hash && ports == other.ports &&
+					*parameters == *other.parameters;
+		}
+
+		unsigned int hash() const
+		{
+			unsigned int h = mkhash(type.hash(), parameters_hash);
+			for (auto &it : ports)
+				h = mkhash(mkhash(h, it.first.hash()), it.second.hash());
+			return h;
+		}
+	};
+
+	cell_key_t cell_key(const RTLIL::Cell *cell)
 	{
-		vector<string> hash_conn_strings;
-		std::string hash_string = cell->type.str() + "\n";
+		cell_key_t key;
+		key.type = cell->type;
+		key.parameters = &cell->parameters;
+		key.parameters_hash = cell->parameters.hash();
 
 		const dict<RTLIL::IdString, RTLIL::SigSpec> *conn = &cell->connections();
 		dict<RTLIL::IdString, RTLIL::SigSpec> alt_conn;
-
-		if (cell->type.in(ID($and), ID($or), ID($xor), ID($xnor), ID($add), ID($mul),
-				ID($logic_and), ID($logic_or), ID($_AND_), ID($_OR_), ID($_XOR_))) {
-			alt_conn = *conn;
-			if (assign_map(alt_conn.at(ID::A)) < assign_map(alt_conn.at(ID::B))) {
-				alt_conn[ID::A] = conn->at(ID::B);
-				alt_conn[ID::B] = conn->at(ID::A);
-			}
-			conn = &alt_conn;
-		} else
-		if (cell->type.in(ID($reduce_xor), ID($reduce_xnor))) {
-			alt_conn = *conn;
-			assign_map.apply(alt_conn.at(ID::A));
-			alt_conn.at(ID::A).sort();
-			conn = &alt_conn;
-		} else
-		if (cell->type.in(ID($reduce_and), ID($reduce_or), ID($reduce_bool))) {
-			alt_conn = *conn;
-			assign_map.apply(alt_conn.at(ID::A));
-			alt_conn.at(ID::A).sort_and_unify();
-			conn = &alt_conn;
-		} else
 		if (cell->type == ID($pmux)) {
 			alt_conn = *conn;
 			assign_map.apply(alt_conn.at(ID::A));
@@ -115,106 +114,40 @@ struct OptMergeWorker
 			conn = &alt_conn;
 		}
 
+		key.ports.reserve(conn->size());
 		for (auto &it : *conn) {
-			RTLIL::SigSpec sig;
+			CompactSigSpec sig;
 			if (cell->output(it.first)) {
 				if (it.first == ID::Q && RTLIL::builtin_ff_cell_types().count(cell->type)) {
 					// For the 'Q' output of state elements,
 					//   use its (* init *) attribute value
 					sig = initvals(it.second);
 				}
-				else
-					continue;
 			}
 			else
 				sig = assign_map(it.second);
-			string s = "C " + it.first.str() + "=";
-			for (auto &chunk : sig.chunks()) {
-				if (chunk.wire)
-					s += "{" + chunk.wire->name.str() + " " +
-							int_to_hash_string(chunk.offset) + " " +
-							int_to_hash_string(chunk.width) + "}";
-				else
-					s += RTLIL::Const(chunk.data).as_string();
-			}
-			hash_conn_strings.push_back(s + "\n");
-		}
-
-		for (auto &it : cell->parameters)
-			hash_conn_strings.push_back("P " + it.first.str() + "=" + it.second.as_string() + "\n");
-
-		std::sort(hash_conn_strings.begin(), hash_conn_strings.end());
-
-		for (auto it : hash_conn_strings)
-			hash_string += it;
-
-		return std::hash<std::string>{}(hash_string);
-	}
-
-	bool compare_cell_parameters_and_connections(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2)
-	{
-		log_assert(cell1 != cell2);
-		if (cell1->type != cell2->type) return false;
-
-		if (cell1->parameters != cell2->parameters)
-			return false;
-
-		if (cell1->connections_.size() != cell2->connections_.size())
-			return false;
-		for (const auto &it : cell1->connections_)
-			if (!cell2->connections_.count(it.first))
-				return false;
-
-		decltype(Cell::connections_) conn1, conn2;
-		conn1.reserve(cell1->connections_.size());
-		conn2.reserve(cell1->connections_.size());
-
-		for (const auto &it : cell1->connections_) {
-			if (cell1->output(it.first)) {
-				if (it.first == ID::Q && RTLIL::builtin_ff_cell_types().count(cell1->type)) {
-					// For the 'Q' output of state elements,
-					//   use the (* init *) attribute value
-					conn1[it.first] = initvals(it.second);
-					conn2[it.first] = initvals(cell2->getPort(it.first));
-				}
-				else {
-					conn1[it.first] = RTLIL::SigSpec();
-					conn2[it.first] = RTLIL::SigSpec();
-				}
-			}
-			else {
-				conn1[it.first] = assign_map(it.second);
-				conn2[it.first] = assign_map(cell2->getPort(it.first));
-			}
+			key.ports.emplace_back(it.first, std::move(sig));
 		}
+		std::sort(key.ports.begin(), key.ports.end(), [](const std::pair<RTLIL::IdString, CompactSigSpec> &a,
+				const std::pair<RTLIL::IdString, CompactSigSpec> &b) {
+			return a.first < b.first;
+		});
 
-		if (cell1->type == ID($and) || cell1->type == ID($or) || cell1->type == ID($xor) || cell1->type == ID($xnor) || cell1->type == ID($add) || cell1->type == ID($mul) ||
-				cell1->type == ID($logic_and) || cell1->type == ID($logic_or) || cell1->type == ID($_AND_) || cell1->type == ID($_OR_) || cell1->type == ID($_XOR_)) {
-			if (conn1.at(ID::A) < conn1.at(ID::B)) {
-				RTLIL::SigSpec tmp = conn1[ID::A];
-				conn1[ID::A] = conn1[ID::B];
-				conn1[ID::B] = tmp;
-			}
-			if (conn2.at(ID::A) < conn2.at(ID::B)) {
-				RTLIL::SigSpec tmp = conn2[ID::A];
-				conn2[ID::A] = conn2[ID::B];
-				conn2[ID::B] = tmp;
-			}
-		} else
-		if (cell1->type == ID($reduce_xor) || cell1->type == ID($reduce_xnor)) {
-			conn1[ID::A].sort();
-			conn2[ID::A].sort();
+		if (cell->type.in(ID($and), ID($or), ID($xor), ID($xnor), ID($add), ID($mul),
+				ID($logic_and), ID($logic_or), ID($_AND_), ID($_OR_), ID($_XOR_))) {
+			CompactSigSpec &sig_a = key.port(ID::A);
+			CompactSigSpec &sig_b = key.port(ID::B);
+			if (sig_a < sig_b)
+				std::swap(sig_a, sig_b);
 		} else
-		if (cell1->type == ID($reduce_and) || cell1->type == ID($reduce_or) || cell1->type == ID($reduce_bool)) {
-			conn1[ID::A].sort_and_unify();
-			conn2[ID::A].sort_and_unify();
+		if (cell->type.in(ID($reduce_xor), ID($reduce_xnor))) {
+			key.port(ID::A).sort();
 		} else
-		if (cell1->type == ID($pmux)) {
-			sort_pmux_conn(conn1);
-			sort_pmux_conn(conn2);
+		if (cell->type.in(ID($reduce_and), ID($reduce_or), ID($reduce_bool))) {
+			key.port(ID::A).sort_and_unify();
 		}
 
-		return conn1 == conn2;
+		return key;
 	}
 
 	bool has_dont_care_initval(const RTLIL::Cell *cell)
@@ -247,7 +180,7 @@ struct OptMergeWorker
 		ct.cell_types.erase(ID($allconst));
 
 		log("Finding identical cells in module `%s'.\n", module->name.c_str());
-		assign_map.set(module);
+		assign_map = module->sigmap();
 
 		initvals.set(&assign_map, module);
 
@@ -266,42 +199,44 @@ struct OptMergeWorker
 			}
 
 			did_something = false;
-                        dict<uint64_t, RTLIL::Cell*> sharemap;
+			dict<cell_key_t, RTLIL::Cell*> sharemap;
 			for (auto cell : cells)
 			{
 				if ((!mode_share_all && !ct.cell_known(cell->type)) || !cell->known())
 					continue;
 
-				uint64_t hash = hash_cell_parameters_and_connections(cell);
-				auto r = sharemap.insert(std::make_pair(hash, cell));
+				auto r = sharemap.insert(std::make_pair(cell_key(cell), cell));
 				if (!r.second) {
-					if (compare_cell_parameters_and_connections(cell, r.first->second)) {
-						if (cell->has_keep_attr()) {
-							if (r.first->second->has_keep_attr())
-								continue;
-							std::swap(r.first->second, cell);
-						}
-
+					if (cell->has_keep_attr()) {
+						if (r.first->second->has_keep_attr())
+							continue;
+						// The key refers to the parameters of the cell that is kept
+						cell_key_t key = r.first->first;
+						key.parameters = &cell->parameters;
+						RTLIL::Cell *other = r.first->second;
+						sharemap.erase(r.first);
+						r = sharemap.insert(std::make_pair(std::move(key), cell));
+						cell = other;
+					}
 
-						did_something = true;
-						log_debug("  Cell `%s' is identical to cell `%s'.\n", cell->name.c_str(), r.first->second->name.c_str());
-						for (auto &it : cell->connections()) {
-							if (cell->output(it.first)) {
-								RTLIL::SigSpec other_sig = r.first->second->getPort(it.first);
-								log_debug("    Redirecting output %s: %s = %s\n", it.first.c_str(),
-										log_signal(it.second), log_signal(other_sig));
-								Const init = initvals(other_sig);
-								initvals.remove_init(it.second);
-								initvals.remove_init(other_sig);
-								module->connect(RTLIL::SigSig(it.second, other_sig));
-								assign_map.add(it.second, other_sig);
-								initvals.set_init(other_sig, init);
-							}
+					did_something = true;
+					log_debug("  Cell `%s' is identical to cell `%s'.\n", cell->name.c_str(), r.first->second->name.c_str());
+					for (auto &it : cell->connections()) {
+						if (cell->output(it.first)) {
+							RTLIL::SigSpec other_sig = r.first->second->getPort(it.first);
+							log_debug("    Redirecting output %s: %s = %s\n", it.first.c_str(),
+									log_signal(it.second), log_signal(other_sig));
+							Const init = initvals(other_sig);
+							initvals.remove_init(it.second);
+							initvals.remove_init(other_sig);
+							module->connect(RTLIL::SigSig(it.second, other_sig));
+							assign_map.add(it.second, other_sig);
+							initvals.set_init(other_sig, init);
 						}
-						log_debug("    Removing %s cell `%s' from module `%s'.\n", cell->type.c_str(), cell->name.c_str(), module->name.c_str());
-						module->remove(cell);
-						total_count++;
 					}
+					log_debug("    Removing %s cell `%s' from module `%s'.\n", cell->type.c_str(), cell->name.c_str(), module->name.c_str());
+					module->remove(cell);
+					total_count++;
 				}
 			}
 		}
@@ -310,8 +245,8 @@ struct OptMergeWorker
 	}
 };
 
-struct OptMergePass : public Pass {
-	OptMergePass() : Pass("opt_merge", "consolidate identical cells") { }
+struct OptMergePass : public ParallelModulePass {
+	OptMergePass() : ParallelModulePass("opt_merge", "consolidate identical cells") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -358,11 +293,16 @@ struct OptMergePass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		int total_count = 0;
-		for (auto module : design->selected_modules()) {
+		std::vector<RTLIL::Module*> modules = design->selected_modules();
+		std::vector<int> module_count(GetSize(modules));
+		execute_modules(design, modules, [&](RTLIL::Module *module, int index) {
 			OptMergeWorker worker(design, module, mode_nomux, mode_share_all, mode_keepdc);
-			total_count += worker.total_count;
-		}
+			module_count[index] = worker.total_count;
+		});
+
+		int total_count = 0;
+		for (int count : module_count)
+			total_count += count;
 
 		if (total_count)
 			design->scratchpad_set_bool("opt.did_something", true);
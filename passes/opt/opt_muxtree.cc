@@ -67,7 +67,7 @@ struct OptMuxtreeWorker
 	pool<int> root_mux_rerun;
 
 	OptMuxtreeWorker(RTLIL::Design *design, RTLIL::Module *module) :
-			design(design), module(module), assign_map(module), removed_count(0)
+			design(design), module(module), assign_map(module->sigmap()), removed_count(0)
 	{
 		log("Running muxtree optimizer on module %s..\n", module->name.c_str());
 
@@ -470,8 +470,8 @@ struct OptMuxtreeWorker
 	}
 };
 
-struct OptMuxtreePass : public Pass {
-	OptMuxtreePass() : Pass("opt_muxtree", "eliminate dead trees in multiplexer trees") { }
+struct OptMuxtreePass : public ParallelModulePass {
+	OptMuxtreePass() : ParallelModulePass("opt_muxtree", "eliminate dead trees in multiplexer trees") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -490,13 +490,18 @@ struct OptMuxtreePass : public Pass {
 		log_header(design, "Executing OPT_MUXTREE pass (detect dead branches in mux trees).\n");
 		extra_args(args, 1, design);
 
-		int total_count = 0;
-		for (auto module : design->selected_whole_modules_warn()) {
+		std::vector<RTLIL::Module*> modules = design->selected_whole_modules_warn();
+		std::vector<int> module_count(GetSize(modules));
+		execute_modules(design, modules, [&](RTLIL::Module *module, int index) {
 			if (module->has_processes_warn())
-				continue;
+				return;
 			OptMuxtreeWorker worker(design, module);
-			total_count += worker.removed_count;
-		}
+			module_count[index] = worker.removed_count;
+		});
+
+		int total_count = 0;
+		for (int count : module_count)
+			total_count += count;
 		if (total_count)
 			design->scratchpad_set_bool("opt.did_something", true);
 		log("Removed %d multiplexer ports.\n", total_count);
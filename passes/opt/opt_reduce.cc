@@ -510,7 +510,7 @@ struct OptReduceWorker
 	}
 
 	OptReduceWorker(RTLIL::Design *design, RTLIL::Module *module, bool do_fine) :
-			design(design), module(module), assign_map(module)
+			design(design), module(module), assign_map(module->sigmap())
 	{
 		log("  Optimizing cells in module %s.\n", module->name.c_str());
 
@@ -605,8 +605,8 @@ struct OptReduceWorker
 	}
 };
 
-struct OptReducePass : public Pass {
-	OptReducePass() : Pass("opt_reduce", "simplify large MUXes and AND/OR gates") { }
+struct OptReducePass : public ParallelModulePass {
+	OptReducePass() : ParallelModulePass("opt_reduce", "simplify large MUXes and AND/OR gates") { }
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -648,14 +648,20 @@ struct OptReducePass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		int total_count = 0;
-		for (auto module : design->selected_modules())
+		std::vector<RTLIL::Module*> modules = design->selected_modules();
+		std::vector<int> module_count(GetSize(modules));
+		execute_modules(design, modules, [&](RTLIL::Module *module, int index) {
 			while (1) {
 				OptReduceWorker worker(design, module, do_fine);
-				total_count += worker.total_count;
+				module_count[index] += worker.total_count;
 				if (worker.total_count == 0)
 					break;
 			}
+		});
+
+		int total_count = 0;
+		for (int count : module_count)
+			total_count += count;
 
 		if (total_count)
 			design->scratchpad_set_bool("opt.did_something", true);
@@ -0,0 +1,88 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/satgen.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct SatSolverPass : public Pass {
+	SatSolverPass() : Pass("satsolver", "configure the SAT solver") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    satsolver [options] [solver]\n");
+		log("\n");
+		log("This command selects and configures the SAT solver used by sat, freduce,\n");
+		log("inject_verify and all other commands that solve SAT problems. Without\n");
+		log("arguments it lists the available solvers and the current configuration.\n");
+		log("\n");
+		log("    -portfolio <num>\n");
+		log("        run <num> MiniSat instances with different seeds, restart policies\n");
+		log("        and phase heuristics in parallel threads on every call. The first\n");
+		log("        answer wins and the other instances are interrupted. 1 disables the\n");
+		log("        portfolio. Only available if Yosys was built with ENABLE_THREADS.\n");
+		log("\n");
+		log("    -share <size>\n");
+		log("        after every call of a portfolio, copy the learnt clauses with at most\n");
+		log("        <size> literals to all instances. 0 disables sharing (default).\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) override
+	{
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-portfolio" && argidx+1 < args.size()) {
+				yosys_sat_portfolio.num_solvers = atoi(args[++argidx].c_str());
+				if (yosys_sat_portfolio.num_solvers < 1)
+					log_cmd_error("The portfolio needs at least one solver.\n");
+#ifndef YOSYS_ENABLE_THREADS
+				if (yosys_sat_portfolio.num_solvers > 1)
+					log_cmd_error("This version of Yosys was built without thread support.\n");
+#endif
+				continue;
+			}
+			if (args[argidx] == "-share" && argidx+1 < args.size()) {
+				yosys_sat_portfolio.share_size = max(0, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			break;
+		}
+		if (argidx+1 < args.size())
+			cmd_error(args, argidx+1, "Extra argument.");
+		if (argidx < args.size()) {
+			SatSolver *solver = yosys_satsolver_list;
+			while (solver && solver->name != args[argidx])
+				solver = solver->next;
+			if (!solver)
+				log_cmd_error("Unknown SAT solver `%s'.\n", args[argidx].c_str());
+			yosys_satsolver = solver;
+		}
+
+		for (auto solver = yosys_satsolver_list; solver; solver = solver->next)
+			log("%s %s\n", solver == yosys_satsolver ? "*" : " ", solver->name.c_str());
+		if (yosys_sat_portfolio.num_solvers > 1)
+			log("Portfolio of %d instances, sharing learnt clauses with up to %d literals.\n",
+					yosys_sat_portfolio.num_solvers, yosys_sat_portfolio.share_size);
+	}
+} SatSolverPass;
+
+PRIVATE_NAMESPACE_END
@@ -456,13 +456,13 @@ void simplemap_get_mappers(dict<IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)>
 
 void simplemap(RTLIL::Module *module, RTLIL::Cell *cell)
 {
-	static dict<IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> mappers;
-	static bool initialized_mappers = false;
-
-	if (!initialized_mappers) {
+	// Initialized once in a thread-safe way, opt_dff maps cells from several threads
+	static const dict<IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> mappers = []() {
+		dict<IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> mappers;
 		simplemap_get_mappers(mappers);
-		initialized_mappers = true;
-	}
+		mappers.settle();
+		return mappers;
+	}();
 
 	mappers.at(cell->type)(module, cell);
 }
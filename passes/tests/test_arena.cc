@@ -0,0 +1,200 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/arena.h"
+#include <chrono>
+
+#ifdef __linux__
+#  include <unistd.h>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+// Resident set size in bytes, or 0 where it cannot be read
+static int64_t resident_bytes()
+{
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f == nullptr)
+		return 0;
+	long size = 0, resident = 0;
+	if (fscanf(f, "%ld %ld", &size, &resident) != 2)
+		resident = 0;
+	fclose(f);
+	return int64_t(resident) * sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct arena_result_t {
+	double build, iterate, remove, destroy;
+	int64_t rss;
+};
+
+// A flat chain of $and cells with one wire per cell output, roughly the shape of a
+// flattened gate-level netlist
+static RTLIL::Module *build_module(const std::vector<RTLIL::IdString> &names, bool arena)
+{
+	bool use_arena = RTLIL::Module::use_arena;
+	RTLIL::Module::use_arena = arena;
+	RTLIL::Module *module = new RTLIL::Module;
+	RTLIL::Module::use_arena = use_arena;
+
+	module->name = ID(test_arena);
+	RTLIL::Wire *prev = module->addWire(ID(in), 8);
+	for (int i = 0; i < GetSize(names) / 2; i++) {
+		RTLIL::Wire *wire = module->addWire(names[2*i], 8);
+		module->addAnd(names[2*i+1], prev, RTLIL::SigSpec(prev).extract_end(4).repeat(2), wire);
+		prev = wire;
+	}
+	return module;
+}
+
+static int iterate_module(RTLIL::Module *module, int rounds)
+{
+	int sum = 0;
+	for (int i = 0; i < rounds; i++) {
+		for (auto cell : module->cells())
+			sum += GetSize(cell->connections()) + cell->type.index_;
+		for (auto wire : module->wires())
+			sum += wire->width + wire->port_id;
+	}
+	return sum;
+}
+
+// Removes every other cell and the wires they drive, then compacts
+static void remove_half(RTLIL::Module *module)
+{
+	std::vector<RTLIL::Cell*> cells;
+	pool<RTLIL::Wire*> wires;
+	int index = 0;
+	for (auto cell : module->cells())
+		if (index++ % 2 == 0) {
+			cells.push_back(cell);
+			wires.insert(cell->getPort(ID::Y).as_wire());
+		}
+	for (auto cell : cells)
+		module->remove(cell);
+	module->remove(wires);
+	module->compact_arena();
+}
+
+struct TestArenaPass : public Pass {
+	TestArenaPass() : Pass("test_arena", "benchmark arena allocation of cells and wires") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_arena [options]\n");
+		log("\n");
+		log("Build the same flat module once with heap allocated and once with arena\n");
+		log("allocated cells and wires (see 'help arena'), and report the time of building,\n");
+		log("iterating over, removing half of and deleting it, as well as the growth of the\n");
+		log("resident set size while building it.\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        the number of cells (default = 1000000).\n");
+		log("\n");
+		log("    -r {integer}\n");
+		log("        the number of rounds of iterating over all cells and wires (default = 10).\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) override
+	{
+		int num_cells = 1000000;
+		int rounds = 10;
+
+		int argidx;
+		for (argidx = 1; argidx < GetSize(args); argidx++)
+		{
+			if (args[argidx] == "-n" && argidx+1 < GetSize(args)) {
+				num_cells = max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-r" && argidx+1 < GetSize(args)) {
+				rounds = max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			break;
+		}
+		if (argidx != GetSize(args))
+			log_cmd_error("Unexpected argument `%s'!\n", args[argidx].c_str());
+
+		log_header(nullptr, "Executing TEST_ARENA pass.\n");
+
+		// The names are interned up front and both modules are alive at the same time, so
+		// neither build can reuse names or memory of the other one
+		std::vector<RTLIL::IdString> names;
+		for (int i = 0; i < num_cells; i++) {
+			names.push_back(stringf("$test_arena$w%d", i));
+			names.push_back(stringf("$test_arena$c%d", i));
+		}
+
+		arena_result_t heap, arena;
+		RTLIL::Module *modules[2];
+		arena_result_t *results[2] = {&heap, &arena};
+		for (int i = 0; i < 2; i++) {
+			int64_t rss = resident_bytes();
+			auto start = std::chrono::steady_clock::now();
+			modules[i] = build_module(names, i == 1);
+			results[i]->build = seconds_since(start);
+			results[i]->rss = resident_bytes() - rss;
+		}
+
+		int checksums[2];
+		for (int i = 0; i < 2; i++) {
+			auto start = std::chrono::steady_clock::now();
+			checksums[i] = iterate_module(modules[i], rounds);
+			results[i]->iterate = seconds_since(start);
+		}
+		if (checksums[0] != checksums[1])
+			log_error("Iterating gave %d on the heap but %d in the arena.\n", checksums[0], checksums[1]);
+
+		for (int i = 0; i < 2; i++) {
+			auto start = std::chrono::steady_clock::now();
+			remove_half(modules[i]);
+			results[i]->remove = seconds_since(start);
+		}
+
+		for (int i = 0; i < 2; i++) {
+			auto start = std::chrono::steady_clock::now();
+			delete modules[i];
+			results[i]->destroy = seconds_since(start);
+		}
+
+		log("%d cells and %d wires.\n\n", num_cells, num_cells + 1);
+		log("  %-10s %12s %12s\n", "", "heap", "arena");
+		log("  %-10s %10.2fms %10.2fms\n", "build", 1000 * heap.build, 1000 * arena.build);
+		log("  %-10s %10.2fms %10.2fms\n", "iterate", 1000 * heap.iterate, 1000 * arena.iterate);
+		log("  %-10s %10.2fms %10.2fms\n", "remove", 1000 * heap.remove, 1000 * arena.remove);
+		log("  %-10s %10.2fms %10.2fms\n", "destroy", 1000 * heap.destroy, 1000 * arena.destroy);
+		if (heap.rss > 0)
+			log("  %-10s %10.1fMB %10.1fMB\n", "rss", heap.rss / 1048576.0, arena.rss / 1048576.0);
+	}
+} TestArenaPass;
+
+PRIVATE_NAMESPACE_END
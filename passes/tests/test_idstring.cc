@@ -0,0 +1,148 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include <chrono>
+
+#ifdef YOSYS_ENABLE_THREADS
+#  include <thread>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+// Interns the names [first, last) of the given prefix and looks up every shared name once per
+// new name, which is roughly the mix of a pass that creates cells with NEW_ID
+static void intern_range(const std::string &prefix, int first, int last, const std::vector<std::string> &shared,
+		std::vector<RTLIL::IdString> &ids)
+{
+	for (int i = first; i < last; i++) {
+		ids[i] = RTLIL::IdString(stringf("%s%d", prefix.c_str(), i));
+		RTLIL::IdString lookup(shared[i % GetSize(shared)]);
+		log_assert(lookup.str() == shared[i % GetSize(shared)]);
+	}
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct TestIdStringPass : public Pass {
+	TestIdStringPass() : Pass("test_idstring", "benchmark and check IdString interning in parallel regions") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_idstring [options]\n");
+		log("\n");
+		log("Intern the same number of new IdStrings once on the main thread and once with\n");
+		log("several threads in a parallel IdString region, check that every thread sees\n");
+		log("the same index for the same name and that the strings are freed after their\n");
+		log("last reference is released, and report the throughput of both.\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        the number of new IdStrings of every run (default = 100000).\n");
+		log("\n");
+		log("    -j {integer}\n");
+		log("        the number of threads of the parallel run (default = 4).\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) override
+	{
+		int num_ids = 100000;
+		int num_threads = 4;
+
+		int argidx;
+		for (argidx = 1; argidx < GetSize(args); argidx++)
+		{
+			if (args[argidx] == "-n" && argidx+1 < GetSize(args)) {
+				num_ids = max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < GetSize(args)) {
+				num_threads = max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			break;
+		}
+		if (argidx != GetSize(args))
+			log_cmd_error("Unexpected argument `%s'!\n", args[argidx].c_str());
+
+#ifndef YOSYS_ENABLE_THREADS
+		log_cmd_error("This version of Yosys is built without thread support.\n");
+#else
+		log_header(nullptr, "Executing TEST_IDSTRING pass.\n");
+
+		// Names that are unique to this invocation, so that every run creates new strings
+		std::string prefix = stringf("\\test_idstring$%d$", autoidx++);
+		std::vector<std::string> shared;
+		std::vector<RTLIL::IdString> shared_ids;
+		for (int i = 0; i < 1024; i++) {
+			shared.push_back(stringf("%sshared$%d", prefix.c_str(), i));
+			shared_ids.push_back(RTLIL::IdString(shared.back()));
+		}
+
+		std::vector<RTLIL::IdString> serial_ids(num_ids);
+		auto start = std::chrono::steady_clock::now();
+		intern_range(prefix + "serial$", 0, num_ids, shared, serial_ids);
+		double serial_time = seconds_since(start);
+
+		// Every thread interns the complete range, so all but one of the threads find most of
+		// the names in the shards of another thread
+		std::vector<std::vector<RTLIL::IdString>> parallel_ids(num_threads, std::vector<RTLIL::IdString>(num_ids));
+		start = std::chrono::steady_clock::now();
+		RTLIL::IdString::begin_parallel();
+		{
+			std::vector<std::thread> threads;
+			for (int t = 0; t < num_threads; t++)
+				threads.emplace_back([&, t]() {
+					int offset = int64_t(num_ids) * t / num_threads;
+					intern_range(prefix + "parallel$", offset, num_ids, shared, parallel_ids[t]);
+					intern_range(prefix + "parallel$", 0, offset, shared, parallel_ids[t]);
+				});
+			for (auto &thread : threads)
+				thread.join();
+		}
+		RTLIL::IdString::end_parallel();
+		double parallel_time = seconds_since(start);
+
+		for (int i = 0; i < num_ids; i++) {
+			RTLIL::IdString id = RTLIL::IdString(stringf("%sparallel$%d", prefix.c_str(), i));
+			for (int t = 0; t < num_threads; t++)
+				if (parallel_ids[t][i] != id)
+					log_error("Thread %d got index %d for `%s', expected %d.\n", t, parallel_ids[t][i].index_, id.c_str(), id.index_);
+		}
+
+		// The references of the threads are counted, so the strings go with their last reference
+		parallel_ids.clear();
+		for (int i = 0; i < num_ids; i++) {
+			std::string name = stringf("%sparallel$%d", prefix.c_str(), i);
+			if (RTLIL::IdString::global_id_index_.count((char*)name.c_str()))
+				log_error("`%s' is still interned after its last reference was released.\n", name.c_str());
+		}
+
+		log("Serial:   %d IdStrings in %.3f s (%.0f per second).\n", num_ids, serial_time, num_ids / serial_time);
+		log("Parallel: %d IdStrings, %d threads, in %.3f s (%.0f per second).\n", num_ids, num_threads,
+				parallel_time, int64_t(num_ids) * num_threads / parallel_time);
+#endif
+	}
+} TestIdStringPass;
+
+PRIVATE_NAMESPACE_END
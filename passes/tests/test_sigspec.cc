@@ -0,0 +1,279 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2024  Matej Bölcskei <mboelcskei@ethz.ch>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/compactsig.h"
+#include <chrono>
+#include <random>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct operation_t {
+	RTLIL::Wire *wire;
+	int offset, width;
+	RTLIL::Const value;
+};
+
+struct SigSpecBenchmark
+{
+	int num_signals;
+	std::mt19937 rng;
+	RTLIL::Module *module;
+	std::vector<RTLIL::Wire*> wires;
+	// Every signal is built from the same pieces by both representations
+	std::vector<std::vector<operation_t>> pieces;
+
+	SigSpecBenchmark(int num_signals, int num_wires, unsigned int seed) : num_signals(num_signals), rng(seed)
+	{
+		module = new RTLIL::Module;
+		module->name = ID(test_sigspec);
+		for (int i = 0; i < num_wires; i++)
+			wires.push_back(module->addWire(stringf("\\w%d", i), 1 + rng() % 64));
+
+		// Mostly whole wires, slices, fills and mixed constants, which are the common connections of cells
+		for (int i = 0; i < num_signals; i++) {
+			pieces.emplace_back();
+			int num_pieces = 1 + (rng() % 4 == 0 ? rng() % 8 : rng() % 2);
+			for (int j = 0; j < num_pieces; j++) {
+				RTLIL::Wire *wire = wires[rng() % wires.size()];
+				switch (rng() % 5) {
+				case 0: {
+					int width = 1 + rng() % 16;
+					pieces.back().push_back(operation_t{nullptr, 0, width, RTLIL::Const(RTLIL::State(rng() % 2), width)});
+					break;
+				}
+				case 1: {
+					int width = 1 + rng() % 16;
+					pieces.back().push_back(operation_t{nullptr, 0, width, RTLIL::Const(int(rng()), width)});
+					break;
+				}
+				case 2: {
+					int offset = rng() % wire->width;
+					pieces.back().push_back(operation_t{wire, offset, 1 + int(rng() % (wire->width - offset)), RTLIL::Const()});
+					break;
+				}
+				default:
+					pieces.back().push_back(operation_t{wire, 0, wire->width, RTLIL::Const()});
+				}
+			}
+		}
+	}
+
+	~SigSpecBenchmark()
+	{
+		delete module;
+	}
+
+	template<typename T>
+	static void append_piece(T &sig, const operation_t &piece)
+	{
+		if (piece.wire)
+			sig.append(RTLIL::SigSpec(piece.wire, piece.offset, piece.width));
+		else
+			sig.append(RTLIL::SigSpec(piece.value));
+	}
+
+	static void append_piece(CompactSigSpec &sig, const operation_t &piece)
+	{
+		if (piece.wire)
+			sig.append(piece.wire, piece.offset, piece.width);
+		else
+			sig.append(piece.value);
+	}
+
+	template<typename T>
+	std::vector<T> build() const
+	{
+		std::vector<T> signals(num_signals);
+		for (int i = 0; i < num_signals; i++)
+			for (auto &piece : pieces[i])
+				append_piece(signals[i], piece);
+		return signals;
+	}
+
+	template<typename T>
+	std::vector<T> extract(const std::vector<T> &signals) const
+	{
+		std::vector<T> result;
+		for (auto &sig : signals) {
+			int offset = GetSize(sig) / 3;
+			result.push_back(sig.extract(offset, GetSize(sig) - 2 * offset));
+		}
+		return result;
+	}
+
+	template<typename T>
+	void replace(std::vector<T> &signals) const
+	{
+		// Swap the lower halves of the first two wires
+		int width = min(wires[0]->width, wires[1]->width) / 2 + 1;
+		T pattern, with;
+		append_piece(pattern, operation_t{wires[0], 0, width, RTLIL::Const()});
+		append_piece(with, operation_t{wires[1], 0, width, RTLIL::Const()});
+		for (auto &sig : signals)
+			sig.replace(pattern, with);
+	}
+
+	template<typename T>
+	static void sort_and_unify(std::vector<T> &signals)
+	{
+		for (auto &sig : signals)
+			sig.sort_and_unify();
+	}
+
+	template<typename T>
+	static int hash(const std::vector<T> &signals)
+	{
+		pool<T> unique;
+		for (auto &sig : signals)
+			unique.insert(sig);
+		return GetSize(unique);
+	}
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void check_equal(const char *operation, const std::vector<RTLIL::SigSpec> &sigspecs, const std::vector<CompactSigSpec> &compact)
+{
+	for (int i = 0; i < GetSize(sigspecs); i++)
+		if (compact[i].to_sigspec() != sigspecs[i])
+			log_error("Results of %s differ for signal %d: %s vs. %s\n", operation, i,
+					log_signal(sigspecs[i]), log_signal(compact[i].to_sigspec()));
+}
+
+struct TestSigSpecPass : public Pass {
+	TestSigSpecPass() : Pass("test_sigspec", "benchmark and check CompactSigSpec against SigSpec") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_sigspec [options]\n");
+		log("\n");
+		log("Build the same random signals with SigSpec and CompactSigSpec, run append,\n");
+		log("extract, replace, sort_and_unify and hashing on both, check that the results\n");
+		log("are equal and report the time of every operation.\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        the number of signals (default = 100000).\n");
+		log("\n");
+		log("    -w {integer}\n");
+		log("        the number of wires the signals are built from (default = 1000).\n");
+		log("\n");
+		log("    -s {positive_integer}\n");
+		log("        use this value as rng seed value (default = 1).\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) override
+	{
+		int num_signals = 100000;
+		int num_wires = 1000;
+		unsigned int seed = 1;
+
+		int argidx;
+		for (argidx = 1; argidx < GetSize(args); argidx++)
+		{
+			if (args[argidx] == "-n" && argidx+1 < GetSize(args)) {
+				num_signals = max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-w" && argidx+1 < GetSize(args)) {
+				num_wires = max(2, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-s" && argidx+1 < GetSize(args)) {
+				seed = atoi(args[++argidx].c_str());
+				continue;
+			}
+			break;
+		}
+		if (argidx != GetSize(args))
+			log_cmd_error("Unexpected argument `%s'!\n", args[argidx].c_str());
+
+		log_header(nullptr, "Executing TEST_SIGSPEC pass.\n");
+		SigSpecBenchmark bench(num_signals, num_wires, seed);
+		dict<std::string, std::pair<double, double>> times;
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<RTLIL::SigSpec> sigspecs = bench.build<RTLIL::SigSpec>();
+		times["append"].first = seconds_since(start);
+		start = std::chrono::steady_clock::now();
+		std::vector<CompactSigSpec> compact = bench.build<CompactSigSpec>();
+		times["append"].second = seconds_since(start);
+		check_equal("append", sigspecs, compact);
+
+		start = std::chrono::steady_clock::now();
+		std::vector<RTLIL::SigSpec> sigspec_slices = bench.extract(sigspecs);
+		times["extract"].first = seconds_since(start);
+		start = std::chrono::steady_clock::now();
+		std::vector<CompactSigSpec> compact_slices = bench.extract(compact);
+		times["extract"].second = seconds_since(start);
+		check_equal("extract", sigspec_slices, compact_slices);
+
+		start = std::chrono::steady_clock::now();
+		bench.replace(sigspecs);
+		times["replace"].first = seconds_since(start);
+		start = std::chrono::steady_clock::now();
+		bench.replace(compact);
+		times["replace"].second = seconds_since(start);
+		check_equal("replace", sigspecs, compact);
+
+		start = std::chrono::steady_clock::now();
+		int sigspec_unique = bench.hash(sigspecs);
+		times["hash"].first = seconds_since(start);
+		start = std::chrono::steady_clock::now();
+		int compact_unique = bench.hash(compact);
+		times["hash"].second = seconds_since(start);
+		if (sigspec_unique != compact_unique)
+			log_error("Found %d unique SigSpecs but %d unique CompactSigSpecs.\n", sigspec_unique, compact_unique);
+
+		start = std::chrono::steady_clock::now();
+		bench.sort_and_unify(sigspecs);
+		times["sort_and_unify"].first = seconds_since(start);
+		start = std::chrono::steady_clock::now();
+		bench.sort_and_unify(compact);
+		times["sort_and_unify"].second = seconds_since(start);
+		check_equal("sort_and_unify", sigspecs, compact);
+
+		// Mixed constants are packed into a single run and stay inline up to 64 bits
+		CompactSigSpec mixed(RTLIL::Const::from_string("0101"));
+		mixed.append(RTLIL::Const::from_string(std::string(30, 'x') + std::string(30, '1')));
+		mixed.append(bench.wires[0], 0, bench.wires[0]->width);
+		if (mixed.num_runs() != 2 || !mixed.is_inline())
+			log_error("Mixed constants of %s are not packed inline.\n", log_signal(mixed.to_sigspec()));
+
+		int num_inline = 0;
+		for (auto &sig : compact)
+			if (sig.is_inline())
+				num_inline++;
+
+		log("%d signals, %d of them stored inline by CompactSigSpec.\n\n", num_signals, num_inline);
+		log("  %-16s %12s %12s %8s\n", "operation", "SigSpec", "Compact", "speedup");
+		for (auto operation : {"append", "extract", "replace", "hash", "sort_and_unify"}) {
+			auto &time = times.at(operation);
+			log("  %-16s %10.2fms %10.2fms %7.2fx\n", operation, 1000 * time.first, 1000 * time.second,
+					time.first / max(time.second, 1e-9));
+		}
+	}
+} TestSigSpecPass;
+
+PRIVATE_NAMESPACE_END
@@ -2311,6 +2311,50 @@ end
 
 endmodule
 
+// --------------------------------------------------------
+
+module \$coverage_map (CLK, ADDR, COUNT);
+
+parameter ABITS = 1;
+parameter PORTS = 1;
+parameter WIDTH = 32;
+parameter CLK_POLARITY = 1'b1;
+
+// Port i marks bit (i << ABITS) + ADDR[i] of a bitset packed into 64-bit words,
+// COUNT is the number of set bits.
+localparam WORDS = ((PORTS << ABITS) + 63) / 64;
+
+input CLK;
+input [PORTS*ABITS-1:0] ADDR;
+output reg [WIDTH-1:0] COUNT;
+
+reg [63:0] map [0:WORDS-1];
+wire pos_clk = CLK == CLK_POLARITY;
+
+integer i;
+reg [ABITS+31:0] index;
+reg [WIDTH-1:0] next;
+
+initial begin
+	for (i = 0; i < WORDS; i = i+1)
+		map[i] = 0;
+	COUNT = 0;
+end
+
+always @(posedge pos_clk) begin
+	next = COUNT;
+	for (i = 0; i < PORTS; i = i+1) begin
+		index = (i << ABITS) + ADDR[i*ABITS +: ABITS];
+		if (!map[index >> 6][index[5:0]]) begin
+			map[index >> 6][index[5:0]] = 1'b1;
+			next = next + 1;
+		end
+	end
+	COUNT <= next;
+end
+
+endmodule
+
 // --------------------------------------------------------
 `ifndef SIMLIB_NOMEM
 